@@ -21,8 +21,72 @@
 #include <numeric>
 #include <cassert>
 #include <unordered_map>
+#include <map>
 #include <filesystem>
 #include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <charconv>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#define _COCO_UNDEF_NOMINMAX
+#endif // NOMINMAX
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define _COCO_UNDEF_WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#ifdef _COCO_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef _COCO_UNDEF_NOMINMAX
+#endif // _COCO_UNDEF_NOMINMAX
+#ifdef _COCO_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef _COCO_UNDEF_WIN32_LEAN_AND_MEAN
+#endif // _COCO_UNDEF_WIN32_LEAN_AND_MEAN
+#else // _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif // __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif // _WIN32
+
+//#define COCO_NETWORK
+
+#ifdef COCO_NETWORK
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else // _WIN32
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#endif // _WIN32
+#endif // COCO_NETWORK
 
 namespace sch = std::chrono;
 
@@ -47,6 +111,45 @@ namespace sch = std::chrono;
 #define COCO_INLINE 
 #endif // _HAS_CXX17
 
+//#define COCO_USDT
+
+#if defined(COCO_USDT) && defined(__linux__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+#define _COCO_USDT_ARG(n, x)						[_COCO_USDT_S##n] "n" ((std::is_signed<std::decay_t<decltype(x)>>::value ? 1 : -1) * static_cast<int>(sizeof(x))), [_COCO_USDT_A##n] "nor" (x)
+#define _COCO_USDT_ARGFMT(n)						"%n[_COCO_USDT_S" #n "]@%[_COCO_USDT_A" #n "]"
+#define _COCO_USDT_PROBE(name, argfmt, ...)												\
+	__asm__ __volatile__(																	\
+		"990: nop\n"																		\
+		".pushsection .note.stapsdt,\"?\",\"note\"\n"											\
+		".balign 4\n"																		\
+		".4byte 992f-991f, 994f-993f, 3\n"													\
+		"991: .asciz \"stapsdt\"\n"															\
+		"992: .balign 4\n"																	\
+		"993: .8byte 990b\n"																\
+		".8byte _.stapsdt.base\n"															\
+		".8byte 0\n"																		\
+		".asciz \"coco\"\n"																	\
+		".asciz \"" #name "\"\n"																\
+		".asciz \"" argfmt "\"\n"																\
+		"994: .balign 4\n"																	\
+		".popsection\n"																		\
+		".ifndef _.stapsdt.base\n"															\
+		".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"					\
+		".weak _.stapsdt.base\n"															\
+		".hidden _.stapsdt.base\n"															\
+		"_.stapsdt.base: .space 1\n"														\
+		".size _.stapsdt.base, 1\n"															\
+		".popsection\n"																		\
+		".endif\n"																			\
+		:: __VA_ARGS__)
+#define COCO_USDT_PROBE1(name, a1)					_COCO_USDT_PROBE(name, _COCO_USDT_ARGFMT(1), _COCO_USDT_ARG(1, a1))
+#define COCO_USDT_PROBE2(name, a1, a2)				_COCO_USDT_PROBE(name, _COCO_USDT_ARGFMT(1) " " _COCO_USDT_ARGFMT(2), _COCO_USDT_ARG(1, a1), _COCO_USDT_ARG(2, a2))
+#define COCO_USDT_PROBE3(name, a1, a2, a3)			_COCO_USDT_PROBE(name, _COCO_USDT_ARGFMT(1) " " _COCO_USDT_ARGFMT(2) " " _COCO_USDT_ARGFMT(3), _COCO_USDT_ARG(1, a1), _COCO_USDT_ARG(2, a2), _COCO_USDT_ARG(3, a3))
+#else // COCO_USDT
+#define COCO_USDT_PROBE1(name, a1)					do {} while (false)
+#define COCO_USDT_PROBE2(name, a1, a2)				do {} while (false)
+#define COCO_USDT_PROBE3(name, a1, a2, a3)			do {} while (false)
+#endif // COCO_USDT
+
 
 namespace coco
 {
@@ -118,681 +221,6915 @@ namespace coco
 			std::string name;
 			long long start, end;
 			size_t threadID;
+			std::string args;
+			int start_cpu = -1;
+			int end_cpu = -1;
+			long long start_ns = 0;
+			long long end_ns = 0;
 		};
 
-		struct instrumentation_session
+		struct page_allocation
 		{
-			std::string m_name;
+			void* memory = nullptr;
+			size_t size = 0;
+			int node = -1;
+			bool huge_pages = false;
 		};
-	}
 
-	class instrumentor
-	{
-	public:
-		instrumentor() : m_current_session(nullptr), m_profile_count(0), m_active(false) {}
+		inline int numa_node_count()
+		{
+			static int count = []()
+				{
+#ifdef _WIN32
+					ULONG highest = 0;
+					return GetNumaHighestNodeNumber(&highest) ? static_cast<int>(highest) + 1 : 1;
+#else // _WIN32
+					std::ifstream online("/sys/devices/system/node/online");
+					std::string ranges;
+					if (!(online >> ranges))
+						return 1;
+					int nodes = 0;
+					size_t position = 0;
+					while (position < ranges.size())
+					{
+						size_t comma = ranges.find(',', position);
+						std::string range = ranges.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+						size_t dash = range.find('-');
+						int first = std::atoi(range.c_str());
+						int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+						nodes = std::max(nodes, last + 1);
+						if (comma == std::string::npos)
+							break;
+						position = comma + 1;
+					}
+					return std::max(nodes, 1);
+#endif // _WIN32
+				}();
+			return count;
+		}
 
-		void begin_session(const std::string& name, const std::string& filepath = "results.json")
+		inline int current_numa_node()
 		{
-			if (!m_active)
-			{
-				m_output_stream.open(filepath);
-				write_header();
-				m_current_session = new detail::instrumentation_session{ name };
-				m_active = true;
-			}
+#ifdef _WIN32
+			UCHAR node = 0;
+			return GetNumaProcessorNode(static_cast<UCHAR>(GetCurrentProcessorNumber()), &node) ? node : 0;
+#elif defined(SYS_getcpu)
+			unsigned cpu = 0, node = 0;
+			return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? static_cast<int>(node) : 0;
+#else // _WIN32
+			return 0;
+#endif // _WIN32
 		}
 
-		void end_session()
+		inline int current_cpu() noexcept
 		{
-			if (m_active)
-			{
-				write_footer();
-				m_output_stream.close();
-				delete m_current_session;
-				m_current_session = nullptr;
-				m_profile_count = 0;
-				m_active = false;
-			}
+#ifdef _WIN32
+			return static_cast<int>(GetCurrentProcessorNumber());
+#elif defined(__GLIBC__)
+			return sched_getcpu();
+#elif defined(SYS_getcpu)
+			unsigned cpu = 0;
+			return syscall(SYS_getcpu, &cpu, nullptr, nullptr) == 0 ? static_cast<int>(cpu) : -1;
+#else // _WIN32
+			return -1;
+#endif // _WIN32
 		}
 
-		void write_profile(const detail::profile_result& result)
+		inline size_t page_size()
 		{
-			COCO_ASSERT(m_active, "write_profile() called on inactive instrumentor");
-			if (m_active)
-			{
-				if (m_profile_count++ > 0)
-					m_output_stream << ",";
+#ifdef _WIN32
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwPageSize;
+#else // _WIN32
+			return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif // _WIN32
+		}
 
-				std::string name = result.name;
-				std::replace(name.begin(), name.end(), '"', '\'');
+		inline page_allocation allocate_local_pages(size_t size, bool numa_local, bool huge_pages, bool prefault)
+		{
+			page_allocation result;
+			size_t granularity = huge_pages ? size_t(2) << 20 : page_size();
+			result.size = (size + granularity - 1) / granularity * granularity;
+			bool bind = numa_local && numa_node_count() > 1;
+			if (bind)
+				result.node = current_numa_node();
 
-				m_output_stream << "{\"cat\":\"function\",";
-				m_output_stream << "\"dur\":" << (result.end - result.start) << ',';
-				m_output_stream << "\"name\":\"" << name << "\",";
-				m_output_stream << "\"ph\":\"X\",";
-				m_output_stream << "\"pid\":0,";
-				m_output_stream << "\"tid\":" << result.threadID << ",";
-				m_output_stream << "\"ts\":" << result.start << "}";
+#ifdef _WIN32
+			DWORD type = MEM_RESERVE | MEM_COMMIT;
+			if (huge_pages && GetLargePageMinimum() != 0)
+			{
+				result.memory = bind ? VirtualAllocExNuma(GetCurrentProcess(), nullptr, result.size, type | MEM_LARGE_PAGES, PAGE_READWRITE, result.node)
+					: VirtualAlloc(nullptr, result.size, type | MEM_LARGE_PAGES, PAGE_READWRITE);
+				result.huge_pages = result.memory != nullptr;
+			}
+			if (!result.memory)
+			{
+				result.memory = bind ? VirtualAllocExNuma(GetCurrentProcess(), nullptr, result.size, type, PAGE_READWRITE, result.node)
+					: VirtualAlloc(nullptr, result.size, type, PAGE_READWRITE);
+			}
+			if (!result.memory)
+				return page_allocation{};
+#else // _WIN32
+#ifdef MAP_HUGETLB
+			if (huge_pages)
+			{
+				void* memory = mmap(nullptr, result.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if (memory != MAP_FAILED)
+				{
+					result.memory = memory;
+					result.huge_pages = true;
+				}
+			}
+#endif // MAP_HUGETLB
+			if (!result.memory)
+			{
+				void* memory = mmap(nullptr, result.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (memory == MAP_FAILED)
+					return page_allocation{};
+				result.memory = memory;
+#ifdef MADV_HUGEPAGE
+				if (huge_pages)
+					madvise(result.memory, result.size, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+			}
+#ifdef SYS_mbind
+			if (bind)
+			{
+				static constexpr int mpol_preferred = 1;
+				unsigned long mask[4] = {};
+				if (result.node >= 0 && result.node < static_cast<int>(sizeof(mask) * 8))
+				{
+					mask[result.node / (sizeof(unsigned long) * 8)] |= 1UL << (result.node % (sizeof(unsigned long) * 8));
+					syscall(SYS_mbind, result.memory, result.size, mpol_preferred, mask, sizeof(mask) * 8, 0);
+				}
+			}
+#endif // SYS_mbind
+#endif // _WIN32
 
-				m_output_stream.flush();
+			if (prefault)
+			{
+				volatile unsigned char* bytes = static_cast<unsigned char*>(result.memory);
+				size_t stride = page_size();
+				for (size_t offset = 0; offset < result.size; offset += stride)
+					bytes[offset] = 0;
 			}
-		}
-	private:
-		void write_header()
-		{
-			m_output_stream << "{\"otherData\": {},\"traceEvents\":[";
-			m_output_stream.flush();
+			return result;
 		}
 
-		void write_footer()
-		{
-			m_output_stream << "]}";
-			m_output_stream.flush();
-		}
-	public:
-		static instrumentor& get()
+		inline void free_local_pages(page_allocation& allocation)
 		{
-			static instrumentor instance;
-			return instance;
+			if (!allocation.memory)
+				return;
+#ifdef _WIN32
+			VirtualFree(allocation.memory, 0, MEM_RELEASE);
+#else // _WIN32
+			munmap(allocation.memory, allocation.size);
+#endif // _WIN32
+			allocation = page_allocation{};
 		}
 
-	private:
-		detail::instrumentation_session* m_current_session;
-		std::ofstream m_output_stream;
-		int m_profile_count;
-		bool m_active;
-	};
-
-	struct dont_start {};
-
-	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
-	class timer
-	{
-	public:
-		timer(const std::string& name = std::string{ "Coco Timer" }, bool print_state = false) : m_name(name), m_print_when_stopped(print_state)
+		struct event_buffer
 		{
-			start();
-		}
+			std::mutex mutex;
+			page_allocation pages;
+			size_t used = 0;
+			size_t events = 0;
+			unsigned generation = 0;
+		};
 
-		timer(dont_start) : m_name(std::string{ "Coco Timer" }), m_print_when_stopped(false)
+		inline long long process_id()
 		{
-			m_time = 0;
-			m_paused = false;
-			m_stopped = true;
+#ifdef _WIN32
+			return static_cast<long long>(GetCurrentProcessId());
+#else // _WIN32
+			return static_cast<long long>(getpid());
+#endif // _WIN32
 		}
 
-		~timer()
+		inline std::string host_name()
 		{
-			stop();
+#ifdef _WIN32
+			const char* name = std::getenv("COMPUTERNAME");
+			return name ? name : "unknown";
+#else // _WIN32
+			char name[256] = {};
+			if (gethostname(name, sizeof(name) - 1) != 0)
+				return "unknown";
+			return name;
+#endif // _WIN32
 		}
 
-		void start()
+		inline std::string process_name()
 		{
-			if (m_stopped)
-			{
-				m_time = 0;
-				m_paused = false;
-				m_stopped = false;
-				m_timepoint = now();
-			}
+#ifdef _WIN32
+			char path[MAX_PATH] = {};
+			if (GetModuleFileNameA(nullptr, path, MAX_PATH) == 0)
+				return "unknown";
+			return std::filesystem::path(path).stem().string();
+#else // _WIN32
+			std::ifstream comm("/proc/self/comm");
+			std::string name;
+			if (!std::getline(comm, name) || name.empty())
+				return "unknown";
+			return name;
+#endif // _WIN32
 		}
 
-		void pause()
+		inline long long monotonic_ns()
 		{
-			COCO_ASSERT(!m_stopped, "pause() called on inactive timer.");
-			if (!m_stopped && !m_paused)
-			{
-				m_paused = true;
-				long long start = tp_cast(m_timepoint).time_since_epoch().count();
-				long long end = tp_cast(now()).time_since_epoch().count();
-				m_time += (end - start);
-			}
+#ifdef _WIN32
+			LARGE_INTEGER counter, frequency;
+			QueryPerformanceCounter(&counter);
+			QueryPerformanceFrequency(&frequency);
+			return static_cast<long long>(static_cast<double>(counter.QuadPart) * 1e9 / static_cast<double>(frequency.QuadPart));
+#else // _WIN32
+			timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#endif // _WIN32
 		}
 
-		void resume()
+		inline long long native_thread_id() noexcept
 		{
-			if (m_paused)
-			{
-				m_paused = false;
-				m_timepoint = now();
-			}
+#ifdef _WIN32
+			return static_cast<long long>(GetCurrentThreadId());
+#elif defined(SYS_gettid)
+			return static_cast<long long>(syscall(SYS_gettid));
+#else // _WIN32
+			return 0;
+#endif // _WIN32
 		}
 
-		void reset()
+		inline long long thread_cpu_time_ns() noexcept
 		{
-			m_time = 0;
-			m_paused = false;
-			m_stopped = false;
-			m_timepoint = now();
+#ifdef _WIN32
+			FILETIME creation, exit, kernel, user;
+			if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+				return 0;
+			unsigned long long ticks = ((static_cast<unsigned long long>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime)
+				+ ((static_cast<unsigned long long>(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+			return static_cast<long long>(ticks * 100);
+#else // _WIN32
+			timespec now;
+			if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+				return 0;
+			return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#endif // _WIN32
 		}
 
-		void stop()
+		struct thread_schedstat
 		{
-			if (!m_stopped)
-			{
-				m_stopped = true;
-				long long start = tp_cast(m_timepoint).time_since_epoch().count();
-				long long end = tp_cast(now()).time_since_epoch().count();
-
-				m_time += (end - start);
-				if (m_print_when_stopped)
-					std::cout << m_name << " : " << m_time << ' ' << _Duration::name << "\n";
-			}
-		}
+			unsigned long long run_ns = 0;
+			unsigned long long wait_ns = 0;
+			unsigned long long timeslices = 0;
+		};
 
-		bool complated_on_time(long long time) const noexcept
+		inline bool read_schedstat(long long native_id, thread_schedstat& out)
 		{
-			if (!m_stopped)
+#ifdef _WIN32
+			(void)native_id;
+			(void)out;
+			return false;
+#else // _WIN32
+			if (native_id <= 0)
 				return false;
-			return time >= m_time;
+			std::ifstream file("/proc/self/task/" + std::to_string(native_id) + "/schedstat");
+			return static_cast<bool>(file >> out.run_ns >> out.wait_ns >> out.timeslices);
+#endif // _WIN32
 		}
 
-		bool is_running() const noexcept
+		inline void abandon_thread(std::thread& thread)
 		{
-			return !m_stopped;
+			std::thread* leaked = new std::thread(std::move(thread));
+			(void)leaked;
 		}
 
-		bool is_paused() const noexcept
+		enum class fork_rank
 		{
-			return m_paused;
-		}
+			component,
+			registry,
+			instrumentor,
+			statistics,
+			allocator
+		};
 
-		void set_print_state(bool state)
+		inline std::atomic<bool>& fork_resume_pending() noexcept
 		{
-			m_print_when_stopped = state;
+			static std::atomic<bool> pending{ false };
+			return pending;
 		}
 
-		bool is_printing() const noexcept
+		// Only the registered components are fork safe. Standalone timer_statistics objects and the
+		// allocators are not registered, so the child must not touch one another thread was using.
+		// Background threads are not restarted in the atfork child; resume() relaunches them on first use.
+		class fork_registry
 		{
-			return m_print_when_stopped;
-		}
+		public:
+			using callback_t = std::function<void()>;
 
-		long long get_time() const
-		{
-			return m_time;
-		}
+			void add(const void* owner, callback_t prepare, callback_t parent, callback_t child, fork_rank rank = fork_rank::component, callback_t resume = {})
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto position = std::find_if(m_handlers.begin(), m_handlers.end(), [rank](const handler& h) { return h.rank < rank; });
+				m_handlers.insert(position, handler{ owner, rank, std::move(prepare), std::move(parent), std::move(child), std::move(resume) });
+			}
 
-		template <_COCO_CONCEPT_DURATION_T _To _COCO_ENABLE_IF_DURATION_T(_To)>
-		long long get_casted_time() const
-		{
-			return duration_count_cast<_Duration, _To>(m_time);
-		}
+			void resume()
+			{
+				if (!fork_resume_pending().exchange(false))
+					return;
+				std::lock_guard<std::mutex> lock(m_mutex);
+				for (const handler& h : m_handlers)
+				{
+					if (h.resume)
+						h.resume();
+				}
+			}
 
-	private:
-		sch::time_point<clock_t> now()
-		{
-			return clock_t::now();
-		}
+			void remove(const void* owner)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_handlers.erase(std::remove_if(m_handlers.begin(), m_handlers.end(), [owner](const handler& h) { return h.owner == owner; }), m_handlers.end());
+			}
 
-		constexpr sch::time_point<clock_t, typename _Duration::type> tp_cast(const sch::time_point<clock_t>& tp)
-		{
-			return sch::time_point_cast<typename _Duration::type>(tp);
-		}
+			static fork_registry& get()
+			{
+				static fork_registry instance;
+				return instance;
+			}
 
-		sch::time_point<clock_t> m_timepoint;
-		std::string m_name;
-		bool m_print_when_stopped;
-		long long m_time = 0;
-		bool m_stopped = true;
-		bool m_paused = false;
-	};
+		private:
+			struct handler
+			{
+				const void* owner;
+				fork_rank rank;
+				callback_t prepare;
+				callback_t parent;
+				callback_t child;
+				callback_t resume;
+			};
 
-	template <typename T>
-	struct is_timer : std::false_type {};
+			fork_registry()
+			{
+#ifndef _WIN32
+				pthread_atfork([]() { get().prepare(); }, []() { get().parent(); }, []() { get().child(); });
+#endif // _WIN32
+			}
 
-	template <typename _Duration>
-	struct is_timer<timer<_Duration>> : std::true_type {};
+			void prepare()
+			{
+				m_mutex.lock();
+				for (auto it = m_handlers.rbegin(); it != m_handlers.rend(); ++it)
+				{
+					if (it->prepare)
+						it->prepare();
+				}
+			}
 
-	template <typename T>
-	COCO_INLINE constexpr bool is_timer_v = is_timer<T>::value;
+			void parent()
+			{
+				for (const handler& h : m_handlers)
+				{
+					if (h.parent)
+						h.parent();
+				}
+				m_mutex.unlock();
+			}
 
-#ifdef __cpp_concepts
-	namespace detail
-	{
-		template <class _Duration>
-		concept timer_type = is_timer_v<_Duration>;
-	}
+			void child()
+			{
+				for (const handler& h : m_handlers)
+				{
+					if (h.child)
+						h.child();
+					if (h.resume)
+						fork_resume_pending().store(true, std::memory_order_relaxed);
+				}
+				m_mutex.unlock();
+			}
 
-#define _COCO_ENABLE_IF_TIMER_T(_Timer)
-#define _COCO_CONCEPT_TIMER_T detail::timer_type
-#else // __cpp_concepts
-#define _COCO_ENABLE_IF_TIMER_T(_Timer) , std::enable_if_t<is_timer_v<_Timer>, int> = 0
-#define _COCO_CONCEPT_TIMER_T class
-#endif // __cpp_concepts
+			std::mutex m_mutex;
+			std::vector<handler> m_handlers;
+		};
 
-	class instrumentation_timer
-	{
-	public:
-		instrumentation_timer(const std::string& name) : m_name(name)
+		inline void resume_after_fork()
 		{
-			start();
+			if (fork_resume_pending().load(std::memory_order_relaxed))
+				fork_registry::get().resume();
 		}
 
-		instrumentation_timer(const std::string& name, dont_start) : m_name(name)
+#ifndef COCO_COMPACT_BLOCK_EVENTS
+#define COCO_COMPACT_BLOCK_EVENTS 4096
+#endif // COCO_COMPACT_BLOCK_EVENTS
+
+#ifndef COCO_COMPACT_MAX_BLOCKS
+#define COCO_COMPACT_MAX_BLOCKS 16
+#endif // COCO_COMPACT_MAX_BLOCKS
+
+		struct compact_event
 		{
-			m_time = 0;
-			m_stopped = true;
-		}
+			std::uint32_t name_id;
+			std::uint32_t start_delta;
+			std::uint32_t duration;
+			std::uint32_t cpus;
+		};
 
-		~instrumentation_timer()
+		static_assert(sizeof(compact_event) == 16, "compact events must stay 16 bytes");
+
+		static constexpr std::uint16_t compact_unknown_cpu = 0xFFFF;
+
+		inline std::uint32_t pack_cpus(int start_cpu, int end_cpu) noexcept
 		{
-			stop();
+			std::uint32_t start = start_cpu < 0 || start_cpu >= compact_unknown_cpu ? compact_unknown_cpu : static_cast<std::uint32_t>(start_cpu);
+			std::uint32_t end = end_cpu < 0 || end_cpu >= compact_unknown_cpu ? compact_unknown_cpu : static_cast<std::uint32_t>(end_cpu);
+			return start | (end << 16);
 		}
 
-		void start()
+		inline int unpack_cpu(std::uint32_t cpus, bool end) noexcept
 		{
-			m_time = 0;
-			m_stopped = false;
-			m_timepoint = now();
+			std::uint32_t cpu = end ? cpus >> 16 : cpus & 0xFFFF;
+			return cpu == compact_unknown_cpu ? -1 : static_cast<int>(cpu);
 		}
 
-		void stop()
+		static constexpr long long compact_base_headroom = 1LL << 31;
+
+		struct compact_event_block
 		{
-			if (!m_stopped)
-			{
-				auto end_timepoint = clock_t::now();
+			long long base;
+			std::uint32_t count;
+			compact_event events[COCO_COMPACT_BLOCK_EVENTS];
+		};
 
-				long long start = tp_cast(m_timepoint).time_since_epoch().count();
-				long long end = tp_cast(end_timepoint).time_since_epoch().count();
+		static constexpr std::uint32_t ctf_magic = 0xC1FC1FC1;
+		static constexpr size_t ctf_packet_limit = size_t(64) << 10;
+		static constexpr size_t ctf_packet_header_size = 64;
 
-				m_time = end - start;
+		enum ctf_event_id : std::uint32_t
+		{
+			ctf_compact_scope = 0,
+			ctf_scope = 1,
+			ctf_counter = 2,
+			ctf_instant = 3,
+			ctf_begin = 4,
+			ctf_name = 5
+		};
 
-				size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
-				instrumentor::get().write_profile({ m_name, start, end, threadID });
-				m_stopped = true;
+		class ctf_packet
+		{
+		public:
+			void begin(const unsigned char* uuid, std::uint32_t stream_id, unsigned long long thread_id, unsigned long long floor = 0)
+			{
+				m_data.clear();
+				put(ctf_magic);
+				m_data.append(reinterpret_cast<const char*>(uuid), 16);
+				put(stream_id);
+				put(0ULL);
+				put(0ULL);
+				put(0ULL);
+				put(0ULL);
+				put(thread_id);
+				m_begin = floor;
+				m_end = floor;
 			}
-		}
 
-		bool complated_on_time(long long time) const noexcept
-		{
-			if (!m_stopped)
-				return false;
+			// Each stream is written by one thread in completion order, so timestamps only
+			// go backwards when the clock itself steps back; hold them at the last one then.
+			void event(std::uint32_t id, unsigned long long timestamp)
+			{
+				timestamp = std::max(timestamp, m_end);
+				if (empty())
+					m_begin = timestamp;
+				m_end = timestamp;
+				put(id);
+				put(timestamp);
+			}
+
+			void put(std::uint16_t value)
+			{
+				m_data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			void put(std::uint32_t value)
+			{
+				m_data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			void put(unsigned long long value)
+			{
+				m_data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			void put(std::string_view value)
+			{
+				m_data.append(value.data(), value.size());
+				m_data.push_back('\0');
+			}
+
+			bool empty() const noexcept
+			{
+				return m_data.size() <= ctf_packet_header_size;
+			}
+
+			size_t size() const noexcept
+			{
+				return m_data.size();
+			}
+
+			unsigned long long last_timestamp() const noexcept
+			{
+				return m_end;
+			}
+
+			void write(std::ostream& stream)
+			{
+				if (empty())
+					return;
+				unsigned long long content_bits = static_cast<unsigned long long>(m_data.size()) * 8;
+				std::memcpy(&m_data[24], &m_begin, sizeof(m_begin));
+				std::memcpy(&m_data[32], &m_end, sizeof(m_end));
+				std::memcpy(&m_data[40], &content_bits, sizeof(content_bits));
+				std::memcpy(&m_data[48], &content_bits, sizeof(content_bits));
+				stream.write(m_data.data(), static_cast<std::streamsize>(m_data.size()));
+				stream.flush();
+				m_data.resize(ctf_packet_header_size);
+			}
+
+		private:
+			std::string m_data;
+			unsigned long long m_begin = 0;
+			unsigned long long m_end = 0;
+		};
+
+		struct compact_event_buffer
+		{
+			std::mutex mutex;
+			size_t threadID = 0;
+			unsigned generation = 0;
+			std::vector<compact_event_block*> blocks;
+			std::vector<compact_event_block*> spare_blocks;
+			std::ofstream ctf_stream;
+			std::vector<bool> ctf_names;
+			unsigned long long ctf_timestamp = 0;
+			std::ofstream ctf_event_stream;
+			ctf_packet ctf_events;
+			unsigned ctf_event_generation = 0;
+
+			~compact_event_buffer()
+			{
+				for (compact_event_block* block : blocks)
+					delete block;
+				for (compact_event_block* block : spare_blocks)
+					delete block;
+			}
+
+			void recycle()
+			{
+				spare_blocks.insert(spare_blocks.end(), blocks.begin(), blocks.end());
+				blocks.clear();
+			}
+
+			compact_event_block* next_block(long long start)
+			{
+				compact_event_block* block;
+				if (spare_blocks.empty())
+				{
+					block = new compact_event_block;
+				}
+				else
+				{
+					block = spare_blocks.back();
+					spare_blocks.pop_back();
+				}
+				block->base = start - compact_base_headroom;
+				block->count = 0;
+				blocks.push_back(block);
+				return block;
+			}
+		};
+
+		static constexpr std::uint32_t invalid_name = std::numeric_limits<std::uint32_t>::max();
+
+#ifndef COCO_NAME_CACHE_SIZE
+#define COCO_NAME_CACHE_SIZE 256
+#endif // COCO_NAME_CACHE_SIZE
+
+		static_assert(COCO_NAME_CACHE_SIZE > 0 && (COCO_NAME_CACHE_SIZE & (COCO_NAME_CACHE_SIZE - 1)) == 0, "COCO_NAME_CACHE_SIZE must be a power of two");
+
+		class name_table
+		{
+		public:
+			std::uint32_t intern(std::string_view name)
+			{
+				unsigned long long hash = hash_name(name);
+				cache_entry& cached = thread_cache()[hash & (COCO_NAME_CACHE_SIZE - 1)];
+				if (cached.hash == hash && cached.name == name)
+					return cached.id;
+
+				std::uint32_t id = find(name, hash);
+				if (id == invalid_name)
+					id = insert(name, hash);
+				if (id == invalid_name)
+					return id;
+				cached = cache_entry{ hash, view(id), id };
+				return id;
+			}
+
+			std::string_view view(std::uint32_t id) const noexcept
+			{
+				if (id >= m_size.load(std::memory_order_acquire))
+					return std::string_view();
+				const entry& e = at(id);
+				return std::string_view(e.text, e.length);
+			}
+
+			std::string name(std::uint32_t id) const
+			{
+				return std::string(view(id));
+			}
+
+			const char* c_str(std::uint32_t id) const noexcept
+			{
+				return id < m_size.load(std::memory_order_acquire) ? at(id).text : "";
+			}
+
+			size_t size() const noexcept
+			{
+				return m_size.load(std::memory_order_acquire);
+			}
+
+			static name_table& get()
+			{
+				static name_table instance;
+				return instance;
+			}
+
+		private:
+			static constexpr size_t first_segment_size = 64;
+			static constexpr size_t segment_count = 24;
+
+			struct entry
+			{
+				unsigned long long hash;
+				const char* text;
+				std::uint32_t length;
+			};
+
+			struct index_table
+			{
+				size_t mask;
+				std::atomic<std::uint32_t>* slots;
+			};
+
+			struct cache_entry
+			{
+				unsigned long long hash = 0;
+				std::string_view name;
+				std::uint32_t id = invalid_name;
+			};
+
+			name_table()
+			{
+				m_index.store(make_index(1024), std::memory_order_release);
+				fork_registry::get().add(this,
+					[this]() { m_mutex.lock(); },
+					[this]() { m_mutex.unlock(); },
+					[this]() { m_mutex.unlock(); },
+					fork_rank::registry);
+			}
+
+			~name_table()
+			{
+				fork_registry::get().remove(this);
+				for (std::uint32_t id = 0; id < m_size.load(std::memory_order_relaxed); ++id)
+					delete[] at(id).text;
+				for (auto& segment : m_segments)
+					delete[] segment.load(std::memory_order_relaxed);
+				m_retired.push_back(m_index.load(std::memory_order_relaxed));
+				for (index_table* index : m_retired)
+				{
+					delete[] index->slots;
+					delete index;
+				}
+			}
+
+			static unsigned long long hash_name(std::string_view name) noexcept
+			{
+				unsigned long long hash = 14695981039346656037ULL;
+				for (char c : name)
+					hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+				return hash;
+			}
+
+			static cache_entry* thread_cache()
+			{
+				static thread_local cache_entry cache[COCO_NAME_CACHE_SIZE];
+				return cache;
+			}
+
+			static index_table* make_index(size_t capacity)
+			{
+				index_table* index = new index_table{ capacity - 1, new std::atomic<std::uint32_t>[capacity] };
+				for (size_t i = 0; i < capacity; ++i)
+					index->slots[i].store(0, std::memory_order_relaxed);
+				return index;
+			}
+
+			static void locate(std::uint32_t id, size_t& segment, size_t& offset) noexcept
+			{
+				size_t block = id / first_segment_size + 1;
+				segment = 0;
+				while (block >> (segment + 1))
+					++segment;
+				offset = id - first_segment_size * ((size_t(1) << segment) - 1);
+			}
+
+			const entry& at(std::uint32_t id) const noexcept
+			{
+				size_t segment, offset;
+				locate(id, segment, offset);
+				return m_segments[segment].load(std::memory_order_acquire)[offset];
+			}
+
+			std::uint32_t find(std::string_view name, unsigned long long hash) const noexcept
+			{
+				const index_table* index = m_index.load(std::memory_order_acquire);
+				for (size_t i = hash & index->mask;; i = (i + 1) & index->mask)
+				{
+					std::uint32_t slot = index->slots[i].load(std::memory_order_acquire);
+					if (slot == 0)
+						return invalid_name;
+					const entry& e = at(slot - 1);
+					if (e.hash == hash && std::string_view(e.text, e.length) == name)
+						return slot - 1;
+				}
+			}
+
+			static void place(index_table& index, std::uint32_t id, unsigned long long hash) noexcept
+			{
+				size_t i = hash & index.mask;
+				while (index.slots[i].load(std::memory_order_relaxed) != 0)
+					i = (i + 1) & index.mask;
+				index.slots[i].store(id + 1, std::memory_order_release);
+			}
+
+			std::uint32_t insert(std::string_view name, unsigned long long hash)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				std::uint32_t id = find(name, hash);
+				if (id != invalid_name)
+					return id;
+
+				id = m_size.load(std::memory_order_relaxed);
+				size_t segment, offset;
+				locate(id, segment, offset);
+				COCO_ASSERT(segment < segment_count, "name table is full");
+				if (segment >= segment_count)
+					return invalid_name;
+				entry* entries = m_segments[segment].load(std::memory_order_relaxed);
+				if (!entries)
+				{
+					entries = new entry[first_segment_size << segment];
+					m_segments[segment].store(entries, std::memory_order_release);
+				}
+				char* text = new char[name.size() + 1];
+				std::memcpy(text, name.data(), name.size());
+				text[name.size()] = '\0';
+				entries[offset] = entry{ hash, text, static_cast<std::uint32_t>(name.size()) };
+				m_size.store(id + 1, std::memory_order_release);
+
+				index_table* index = m_index.load(std::memory_order_relaxed);
+				if ((static_cast<size_t>(id) + 1) * 2 > index->mask + 1)
+				{
+					index_table* grown = make_index((index->mask + 1) * 2);
+					for (std::uint32_t existing = 0; existing <= id; ++existing)
+						place(*grown, existing, at(existing).hash);
+					m_index.store(grown, std::memory_order_release);
+					m_retired.push_back(index);
+				}
+				else
+				{
+					place(*index, id, hash);
+				}
+				return id;
+			}
+
+			std::mutex m_mutex;
+			std::atomic<entry*> m_segments[segment_count] = {};
+			std::atomic<std::uint32_t> m_size{ 0 };
+			std::atomic<index_table*> m_index{ nullptr };
+			std::vector<index_table*> m_retired;
+		};
+
+		inline void generate_uuid(unsigned char* uuid)
+		{
+			std::random_device device;
+			for (size_t i = 0; i < 16; i += 4)
+			{
+				unsigned value = device();
+				std::memcpy(uuid + i, &value, 4);
+			}
+			uuid[6] = static_cast<unsigned char>((uuid[6] & 0x0F) | 0x40);
+			uuid[8] = static_cast<unsigned char>((uuid[8] & 0x3F) | 0x80);
+		}
+
+		inline std::string format_uuid(const unsigned char* uuid)
+		{
+			static constexpr char digits[] = "0123456789abcdef";
+			std::string result;
+			for (size_t i = 0; i < 16; ++i)
+			{
+				if (i == 4 || i == 6 || i == 8 || i == 10)
+					result.push_back('-');
+				result.push_back(digits[uuid[i] >> 4]);
+				result.push_back(digits[uuid[i] & 0x0F]);
+			}
+			return result;
+		}
+
+		inline std::string ctf_metadata(const unsigned char* uuid, const std::string& session, long long pid)
+		{
+			auto quoted = [](std::string value)
+				{
+					std::replace(value.begin(), value.end(), '"', '\'');
+					return value;
+				};
+			const std::uint16_t endian_probe = 1;
+			bool little_endian = *reinterpret_cast<const unsigned char*>(&endian_probe) == 1;
+
+			std::string tsdl = "/* CTF 1.8 */\n\n";
+			tsdl += "typealias integer { size = 8; align = 8; signed = false; } := uint8_t;\n";
+			tsdl += "typealias integer { size = 16; align = 8; signed = false; } := uint16_t;\n";
+			tsdl += "typealias integer { size = 32; align = 8; signed = false; } := uint32_t;\n";
+			tsdl += "typealias integer { size = 64; align = 8; signed = false; } := uint64_t;\n\n";
+			tsdl += "trace {\n\tmajor = 1;\n\tminor = 8;\n\tuuid = \"" + format_uuid(uuid) + "\";\n";
+			tsdl += std::string("\tbyte_order = ") + (little_endian ? "le" : "be") + ";\n";
+			tsdl += "\tpacket.header := struct {\n\t\tuint32_t magic;\n\t\tuint8_t uuid[16];\n\t\tuint32_t stream_id;\n\t};\n};\n\n";
+			tsdl += "env {\n\thostname = \"" + quoted(host_name()) + "\";\n\ttracer_name = \"coco\";\n";
+			tsdl += "\tprocname = \"" + quoted(process_name()) + "\";\n\tvpid = " + std::to_string(pid) + ";\n";
+			tsdl += "\tsession = \"" + quoted(session) + "\";\n};\n\n";
+			tsdl += "clock {\n\tname = \"coco\";\n\tdescription = \"coco trace clock\";\n\tfreq = 1000000000;\n\toffset = 0;\n};\n\n";
+			tsdl += "typealias integer { size = 64; align = 8; signed = false; map = clock.coco.value; } := uint64_clock_t;\n\n";
+			tsdl += "struct packet_context {\n\tuint64_clock_t timestamp_begin;\n\tuint64_clock_t timestamp_end;\n\tuint64_t content_size;\n\tuint64_t packet_size;\n\tuint64_t thread_id;\n};\n\n";
+			tsdl += "struct event_header {\n\tuint32_t id;\n\tuint64_clock_t timestamp;\n};\n\n";
+			for (int stream = 0; stream < 2; ++stream)
+				tsdl += "stream {\n\tid = " + std::to_string(stream) + ";\n\tpacket.context := struct packet_context;\n\tevent.header := struct event_header;\n};\n\n";
+			tsdl += "/* Scope events are stamped when the scope ends; it began at timestamp - duration.\n * Other events are stamped when they are written. Each thread writes its own streams. */\n\n";
+			tsdl += "event {\n\tname = \"coco:scope\";\n\tid = 0;\n\tstream_id = 0;\n\tfields := struct {\n\t\tuint32_t name_id;\n\t\tuint64_t duration;\n\t\tuint16_t cpu;\n\t\tuint16_t end_cpu;\n\t};\n};\n\n";
+			tsdl += "event {\n\tname = \"coco:name\";\n\tid = 5;\n\tstream_id = 0;\n\tfields := struct {\n\t\tuint32_t name_id;\n\t\tstring name;\n\t};\n};\n\n";
+			tsdl += "event {\n\tname = \"coco:scope\";\n\tid = 1;\n\tstream_id = 1;\n\tfields := struct {\n\t\tuint64_t tid;\n\t\tstring name;\n\t\tuint64_t duration;\n\t\tuint16_t cpu;\n\t\tuint16_t end_cpu;\n\t\tstring args;\n\t};\n};\n\n";
+			const char* names[] = { "coco:counter", "coco:instant", "coco:begin" };
+			for (int i = 0; i < 3; ++i)
+				tsdl += "event {\n\tname = \"" + std::string(names[i]) + "\";\n\tid = " + std::to_string(i + 2) + ";\n\tstream_id = 1;\n\tfields := struct {\n\t\tuint64_t tid;\n\t\tstring name;\n\t\tstring args;\n\t};\n};\n\n";
+			return tsdl;
+		}
+
+		struct instrumentation_session
+		{
+			std::string m_name;
+		};
+	}
+
+	struct event_buffer_options
+	{
+		bool enabled = false;
+		size_t size = size_t(1) << 20;
+		bool numa_local = true;
+		bool huge_pages = false;
+		bool prefault = true;
+	};
+
+	enum class session_format
+	{
+		json,
+		ctf
+	};
+
+	class instrumentor
+	{
+	public:
+		instrumentor() : m_current_session(nullptr), m_profile_count(0), m_active(false), m_pid(detail::process_id())
+		{
+			detail::fork_registry::get().add(this,
+				[this]()
+				{
+					m_buffer_mutex.lock();
+					m_mutex.lock();
+				},
+				[this]()
+				{
+					m_mutex.unlock();
+					m_buffer_mutex.unlock();
+				},
+				[this]()
+				{
+					reopen_in_child();
+					m_mutex.unlock();
+					m_buffer_mutex.unlock();
+				},
+				detail::fork_rank::instrumentor);
+		}
+
+		~instrumentor()
+		{
+			detail::fork_registry::get().remove(this);
+		}
+
+		void begin_session(const std::string& name, const std::string& filepath = "results.json", session_format format = session_format::json)
+		{
+			detail::resume_after_fork();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_active)
+			{
+				m_filepath = filepath;
+				m_current_session = new detail::instrumentation_session{ name };
+				m_ctf = format == session_format::ctf;
+				if (m_ctf)
+				{
+					open_ctf_session();
+				}
+				else
+				{
+					m_output_stream.open(filepath);
+					write_header();
+					write_session_metadata();
+				}
+				m_generation.fetch_add(1, std::memory_order_release);
+				m_active = true;
+			}
+		}
+
+		const std::string& get_filepath() const noexcept
+		{
+			return m_filepath;
+		}
+
+		long long get_pid() const noexcept
+		{
+			return m_pid;
+		}
+
+		void end_session()
+		{
+			{
+				std::lock_guard<std::mutex> registry(m_buffer_mutex);
+				for (detail::event_buffer* buffer : m_buffers)
+				{
+					std::lock_guard<std::mutex> lock(buffer->mutex);
+					flush_buffer(*buffer);
+				}
+				for (detail::compact_event_buffer* buffer : m_compact_buffers)
+				{
+					std::lock_guard<std::mutex> lock(buffer->mutex);
+					flush_compact(*buffer);
+					close_ctf_streams(*buffer);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_active)
+			{
+				if (!m_ctf)
+					write_footer();
+				m_output_stream.close();
+				delete m_current_session;
+				m_current_session = nullptr;
+				m_profile_count = 0;
+				m_active = false;
+			}
+		}
+
+		void write_profile(const detail::profile_result& result)
+		{
+			COCO_ASSERT(m_active, "write_profile() called on inactive instrumentor");
+			write_event(result, "X", "function");
+		}
+
+		void write_begin(const detail::profile_result& result)
+		{
+			write_event(result, "B", "watchdog");
+		}
+
+		void write_counter(const detail::profile_result& result)
+		{
+			write_event(result, "C", "counter");
+		}
+
+		void write_instant(const detail::profile_result& result)
+		{
+			write_event(result, "i", "frame");
+		}
+
+		void write_compact(std::uint32_t name_id, sch::time_point<clock_t> start, sch::time_point<clock_t> end, int start_cpu = -1, int end_cpu = -1)
+		{
+			if (name_id == detail::invalid_name)
+				return;
+			long long start_ns = sch::duration_cast<sch::nanoseconds>(start.time_since_epoch()).count();
+			long long duration_ns = sch::duration_cast<sch::nanoseconds>(end - start).count();
+			if (!m_active)
+			{
+				if (m_has_observer)
+					notify_scope_observer({ detail::name_table::get().name(name_id), to_trace_time(start_ns), to_trace_time(start_ns + duration_ns),
+						std::hash<std::thread::id>{}(std::this_thread::get_id()), {}, start_cpu, end_cpu, start_ns, start_ns + duration_ns });
+				return;
+			}
+			detail::compact_event_buffer* buffer = duration_ns >= 0 && duration_ns <= std::numeric_limits<std::uint32_t>::max() ? thread_compact_buffer() : nullptr;
+			if (!buffer)
+			{
+				write_profile({ detail::name_table::get().name(name_id), to_trace_time(start_ns), to_trace_time(start_ns + duration_ns), std::hash<std::thread::id>{}(std::this_thread::get_id()), {}, start_cpu, end_cpu, start_ns, start_ns + duration_ns });
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(buffer->mutex);
+				unsigned generation = m_generation.load(std::memory_order_acquire);
+				if (buffer->generation != generation)
+				{
+					buffer->recycle();
+					buffer->generation = generation;
+				}
+				detail::compact_event_block* block = buffer->blocks.empty() ? nullptr : buffer->blocks.back();
+				if (!block || block->count == COCO_COMPACT_BLOCK_EVENTS || start_ns < block->base || start_ns - block->base > std::numeric_limits<std::uint32_t>::max())
+				{
+					if (buffer->blocks.size() >= COCO_COMPACT_MAX_BLOCKS)
+						flush_compact(*buffer);
+					block = buffer->next_block(start_ns);
+				}
+				block->events[block->count++] = detail::compact_event{ name_id, static_cast<std::uint32_t>(start_ns - block->base), static_cast<std::uint32_t>(duration_ns), detail::pack_cpus(start_cpu, end_cpu) };
+			}
+
+			if (m_has_observer)
+				notify_scope_observer({ detail::name_table::get().name(name_id), to_trace_time(start_ns), to_trace_time(start_ns + duration_ns), buffer->threadID, {}, start_cpu, end_cpu, start_ns, start_ns + duration_ns });
+		}
+
+		void set_cpu_tracking(bool enabled) noexcept
+		{
+			m_cpu_tracking.store(enabled, std::memory_order_relaxed);
+		}
+
+		bool is_cpu_tracking() const noexcept
+		{
+			return m_cpu_tracking.load(std::memory_order_relaxed);
+		}
+
+		void set_scope_observer(std::function<void(const detail::profile_result&)> observer)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_has_observer = static_cast<bool>(observer);
+			m_scope_observer = std::move(observer);
+		}
+
+		void set_event_buffer_options(const event_buffer_options& options)
+		{
+			std::lock_guard<std::mutex> registry(m_buffer_mutex);
+			m_buffer_options = options;
+			m_buffering = options.enabled;
+		}
+
+		bool register_thread()
+		{
+			return m_buffering && thread_buffer() != nullptr;
+		}
+
+		void flush_thread()
+		{
+			detail::event_buffer* buffer = m_buffering ? thread_buffer() : nullptr;
+			if (buffer)
+			{
+				std::lock_guard<std::mutex> lock(buffer->mutex);
+				flush_buffer(*buffer);
+			}
+		}
+
+		bool is_active() const noexcept
+		{
+			return m_active;
+		}
+
+	private:
+		struct thread_buffer_holder
+		{
+			detail::event_buffer* buffer = nullptr;
+			detail::compact_event_buffer* compact = nullptr;
+
+			~thread_buffer_holder()
+			{
+				if (buffer)
+					instrumentor::get().release_buffer(buffer);
+				if (compact)
+					instrumentor::get().release_compact_buffer(compact);
+			}
+		};
+
+		static thread_buffer_holder& current_holder()
+		{
+			static thread_local thread_buffer_holder holder;
+			return holder;
+		}
+
+		detail::event_buffer* thread_buffer()
+		{
+			thread_buffer_holder& holder = current_holder();
+			if (!holder.buffer)
+				holder.buffer = acquire_buffer();
+			return holder.buffer;
+		}
+
+		detail::compact_event_buffer* thread_compact_buffer()
+		{
+			thread_buffer_holder& holder = current_holder();
+			if (!holder.compact)
+			{
+				holder.compact = new detail::compact_event_buffer;
+				holder.compact->threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				holder.compact->generation = m_generation.load(std::memory_order_acquire);
+				std::lock_guard<std::mutex> registry(m_buffer_mutex);
+				m_compact_buffers.push_back(holder.compact);
+			}
+			return holder.compact;
+		}
+
+		void release_compact_buffer(detail::compact_event_buffer* buffer)
+		{
+			std::lock_guard<std::mutex> registry(m_buffer_mutex);
+			m_compact_buffers.erase(std::remove(m_compact_buffers.begin(), m_compact_buffers.end(), buffer), m_compact_buffers.end());
+			{
+				std::lock_guard<std::mutex> lock(buffer->mutex);
+				flush_compact(*buffer);
+				close_ctf_streams(*buffer);
+			}
+			delete buffer;
+		}
+
+		void flush_compact(detail::compact_event_buffer& buffer)
+		{
+			if (!buffer.blocks.empty() && m_ctf)
+			{
+				write_ctf_blocks(buffer);
+			}
+			else if (!buffer.blocks.empty())
+			{
+				std::unordered_map<std::uint32_t, std::string> names;
+				std::string out;
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_active && buffer.generation == m_generation.load(std::memory_order_relaxed))
+				{
+					for (const detail::compact_event_block* block : buffer.blocks)
+					{
+						for (std::uint32_t i = 0; i < block->count; ++i)
+						{
+							const detail::compact_event& event = block->events[i];
+							auto name = names.find(event.name_id);
+							if (name == names.end())
+								name = names.emplace(event.name_id, detail::name_table::get().name(event.name_id)).first;
+							long long start_ns = block->base + event.start_delta;
+							if (m_profile_count++ > 0)
+								out += ',';
+							out += format_event({ name->second, to_trace_time(start_ns), to_trace_time(start_ns + event.duration), buffer.threadID, {},
+								detail::unpack_cpu(event.cpus, false), detail::unpack_cpu(event.cpus, true) }, "X", "function");
+						}
+					}
+					m_output_stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+					m_output_stream.flush();
+				}
+			}
+			buffer.recycle();
+		}
+
+		void write_ctf_blocks(detail::compact_event_buffer& buffer)
+		{
+			unsigned char uuid[16];
+			std::filesystem::path directory;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_active || buffer.generation != m_generation.load(std::memory_order_relaxed))
+					return;
+				std::memcpy(uuid, m_ctf_uuid, sizeof(uuid));
+				directory = m_filepath;
+			}
+			if (!buffer.ctf_stream.is_open())
+			{
+				buffer.ctf_stream.open(directory / ("stream_" + std::to_string(buffer.threadID)), std::ios::binary);
+				buffer.ctf_names.clear();
+				buffer.ctf_timestamp = 0;
+			}
+
+			detail::ctf_packet packet;
+			for (const detail::compact_event_block* block : buffer.blocks)
+			{
+				packet.begin(uuid, 0, buffer.threadID, buffer.ctf_timestamp);
+				for (std::uint32_t i = 0; i < block->count; ++i)
+				{
+					const detail::compact_event& event = block->events[i];
+					unsigned long long timestamp = static_cast<unsigned long long>(block->base + event.start_delta + event.duration);
+					if (event.name_id >= buffer.ctf_names.size())
+						buffer.ctf_names.resize(event.name_id + 1);
+					if (!buffer.ctf_names[event.name_id])
+					{
+						buffer.ctf_names[event.name_id] = true;
+						packet.event(detail::ctf_name, timestamp);
+						packet.put(event.name_id);
+						packet.put(detail::name_table::get().view(event.name_id));
+					}
+					packet.event(detail::ctf_compact_scope, timestamp);
+					packet.put(event.name_id);
+					packet.put(static_cast<unsigned long long>(event.duration));
+					packet.put(static_cast<std::uint16_t>(event.cpus & 0xFFFF));
+					packet.put(static_cast<std::uint16_t>(event.cpus >> 16));
+				}
+				packet.write(buffer.ctf_stream);
+				buffer.ctf_timestamp = packet.last_timestamp();
+			}
+		}
+
+		void open_ctf_session()
+		{
+			std::filesystem::path directory(m_filepath);
+			std::filesystem::create_directories(directory);
+			detail::generate_uuid(m_ctf_uuid);
+			std::ofstream metadata(directory / "metadata", std::ios::binary);
+			metadata << detail::ctf_metadata(m_ctf_uuid, m_current_session->m_name, m_pid);
+		}
+
+		// Non-compact events go to a stream of the thread writing them, so every stream
+		// is appended in the order its writer produced the events.
+		bool open_ctf_events(detail::compact_event_buffer& buffer)
+		{
+			unsigned generation = m_generation.load(std::memory_order_acquire);
+			if (buffer.ctf_event_stream.is_open() && buffer.ctf_event_generation == generation)
+				return true;
+
+			unsigned char uuid[16];
+			std::filesystem::path directory;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_active)
+					return false;
+				generation = m_generation.load(std::memory_order_relaxed);
+				std::memcpy(uuid, m_ctf_uuid, sizeof(uuid));
+				directory = m_filepath;
+			}
+			bool reopen = buffer.ctf_event_generation == generation;
+			if (buffer.ctf_event_stream.is_open())
+				buffer.ctf_event_stream.close();
+			buffer.ctf_event_stream.open(directory / ("events_" + std::to_string(buffer.threadID)), std::ios::binary | (reopen ? std::ios::app : std::ios::trunc));
+			buffer.ctf_events.begin(uuid, 1, buffer.threadID, reopen ? buffer.ctf_events.last_timestamp() : 0);
+			buffer.ctf_event_generation = generation;
+			return buffer.ctf_event_stream.is_open();
+		}
+
+		void close_ctf_streams(detail::compact_event_buffer& buffer)
+		{
+			if (buffer.ctf_stream.is_open())
+				buffer.ctf_stream.close();
+			if (buffer.ctf_event_stream.is_open())
+			{
+				buffer.ctf_events.write(buffer.ctf_event_stream);
+				buffer.ctf_event_stream.close();
+			}
+		}
+
+		// Scopes are stamped when they end, other events when they are written.
+		void write_ctf_event(const detail::profile_result& result, const char* phase)
+		{
+			detail::compact_event_buffer* buffer = thread_compact_buffer();
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+			if (!open_ctf_events(*buffer))
+				return;
+			static constexpr long long ns_per_tick = 1000000000LL / time_units::milliseconds::type::period::den;
+			long long start_ns = result.start_ns;
+			long long end_ns = result.end_ns;
+			if (!start_ns && !end_ns)
+			{
+				start_ns = result.start * ns_per_tick;
+				end_ns = result.end * ns_per_tick;
+			}
+			unsigned long long timestamp = static_cast<unsigned long long>(phase[0] == 'X' ? end_ns : sch::duration_cast<sch::nanoseconds>(clock_t::now().time_since_epoch()).count());
+			detail::ctf_packet& packet = buffer->ctf_events;
+			switch (phase[0])
+			{
+			case 'X': packet.event(detail::ctf_scope, timestamp); break;
+			case 'C': packet.event(detail::ctf_counter, timestamp); break;
+			case 'i': packet.event(detail::ctf_instant, timestamp); break;
+			default: packet.event(detail::ctf_begin, timestamp); break;
+			}
+			packet.put(static_cast<unsigned long long>(result.threadID));
+			packet.put(result.name);
+			if (phase[0] == 'X')
+			{
+				std::uint32_t cpus = detail::pack_cpus(result.start_cpu, result.end_cpu);
+				packet.put(static_cast<unsigned long long>(std::max(end_ns - start_ns, 0LL)));
+				packet.put(static_cast<std::uint16_t>(cpus & 0xFFFF));
+				packet.put(static_cast<std::uint16_t>(cpus >> 16));
+			}
+			packet.put(result.args);
+			if (packet.size() >= detail::ctf_packet_limit)
+				packet.write(buffer->ctf_event_stream);
+		}
+
+		static long long to_trace_time(long long ns)
+		{
+			return sch::time_point_cast<time_units::milliseconds::type>(sch::time_point<clock_t>(sch::duration_cast<clock_t::duration>(sch::nanoseconds(ns)))).time_since_epoch().count();
+		}
+
+		void reopen_in_child()
+		{
+			m_pid = detail::process_id();
+			detail::event_buffer* own = current_holder().buffer;
+			for (detail::event_buffer* buffer : m_buffers)
+			{
+				if (buffer != own)
+					detail::free_local_pages(buffer->pages);
+			}
+			m_buffers.clear();
+			if (own)
+				m_buffers.push_back(own);
+			detail::compact_event_buffer* own_compact = current_holder().compact;
+			m_compact_buffers.clear();
+			if (own_compact)
+			{
+				m_compact_buffers.push_back(own_compact);
+				own_compact->ctf_stream.close();
+				own_compact->ctf_event_stream.close();
+			}
+			m_generation.fetch_add(1, std::memory_order_release);
+
+			if (m_active)
+			{
+				m_output_stream.close();
+				std::filesystem::path path(m_filepath);
+				if (!path.has_filename())
+					path = path.parent_path();
+				path.replace_filename(path.stem().string() + "." + std::to_string(m_pid) + path.extension().string());
+				m_filepath = path.string();
+				m_profile_count = 0;
+				if (m_ctf)
+				{
+					open_ctf_session();
+				}
+				else
+				{
+					m_output_stream.open(m_filepath);
+					write_header();
+					write_session_metadata();
+				}
+			}
+		}
+
+		detail::event_buffer* acquire_buffer()
+		{
+			std::lock_guard<std::mutex> registry(m_buffer_mutex);
+			if (!m_buffer_options.enabled)
+				return nullptr;
+			detail::page_allocation pages = detail::allocate_local_pages(m_buffer_options.size, m_buffer_options.numa_local, m_buffer_options.huge_pages, m_buffer_options.prefault);
+			if (!pages.memory)
+				return nullptr;
+			detail::event_buffer* buffer = new detail::event_buffer;
+			buffer->pages = pages;
+			buffer->generation = m_generation.load(std::memory_order_acquire);
+			m_buffers.push_back(buffer);
+			return buffer;
+		}
+
+		void release_buffer(detail::event_buffer* buffer)
+		{
+			std::lock_guard<std::mutex> registry(m_buffer_mutex);
+			m_buffers.erase(std::remove(m_buffers.begin(), m_buffers.end(), buffer), m_buffers.end());
+			{
+				std::lock_guard<std::mutex> lock(buffer->mutex);
+				flush_buffer(*buffer);
+				detail::free_local_pages(buffer->pages);
+			}
+			delete buffer;
+		}
+
+		void flush_buffer(detail::event_buffer& buffer)
+		{
+			if (buffer.events != 0)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_active && buffer.generation == m_generation.load(std::memory_order_relaxed))
+				{
+					const char* data = static_cast<const char*>(buffer.pages.memory);
+					size_t skip = m_profile_count == 0 ? 1 : 0;
+					m_output_stream.write(data + skip, static_cast<std::streamsize>(buffer.used - skip));
+					m_output_stream.flush();
+					m_profile_count += static_cast<int>(buffer.events);
+				}
+			}
+			buffer.used = 0;
+			buffer.events = 0;
+		}
+
+		void notify_scope_observer(const detail::profile_result& result)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_scope_observer)
+				m_scope_observer(result);
+		}
+
+		void write_event(const detail::profile_result& result, const char* phase, const char* category)
+		{
+			if (phase[0] == 'X' && m_has_observer)
+				notify_scope_observer(result);
+			if (m_ctf)
+			{
+				write_ctf_event(result, phase);
+				return;
+			}
+			detail::event_buffer* buffer = m_buffering && m_active ? thread_buffer() : nullptr;
+			if (!buffer)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_active)
+				{
+					if (m_profile_count++ > 0)
+						m_output_stream << ",";
+					m_output_stream << format_event(result, phase, category);
+					m_output_stream.flush();
+				}
+				return;
+			}
+
+			std::string event = "," + format_event(result, phase, category);
+			{
+				std::lock_guard<std::mutex> lock(buffer->mutex);
+				unsigned generation = m_generation.load(std::memory_order_acquire);
+				if (buffer->generation != generation)
+				{
+					buffer->used = 0;
+					buffer->events = 0;
+					buffer->generation = generation;
+				}
+				if (buffer->used + event.size() > buffer->pages.size)
+					flush_buffer(*buffer);
+				if (event.size() <= buffer->pages.size)
+				{
+					std::memcpy(static_cast<char*>(buffer->pages.memory) + buffer->used, event.data(), event.size());
+					buffer->used += event.size();
+					++buffer->events;
+				}
+				else
+				{
+					std::lock_guard<std::mutex> direct(m_mutex);
+					if (m_active)
+					{
+						m_output_stream << (m_profile_count++ > 0 ? event.c_str() : event.c_str() + 1);
+						m_output_stream.flush();
+					}
+				}
+			}
+		}
+
+		std::string format_event(const detail::profile_result& result, const char* phase, const char* category) const
+		{
+			std::string name = result.name;
+			std::replace(name.begin(), name.end(), '"', '\'');
+
+			std::string args = result.args;
+			if (result.start_cpu >= 0)
+			{
+				if (!args.empty())
+					args += ',';
+				args += "\"cpu\":" + std::to_string(result.start_cpu) + ",\"end_cpu\":" + std::to_string(result.end_cpu);
+			}
+
+			std::string event = "{";
+			if (!args.empty())
+				event += "\"args\":{" + args + "},";
+			event += "\"cat\":\"" + std::string(category) + "\",";
+			if (phase[0] == 'X')
+				event += "\"dur\":" + std::to_string(result.end - result.start) + ',';
+			event += "\"name\":\"" + name + "\",";
+			event += "\"ph\":\"" + std::string(phase) + "\",";
+			event += "\"pid\":" + std::to_string(m_pid) + ",";
+			if (phase[0] == 'i')
+				event += "\"s\":\"g\",";
+			event += "\"tid\":" + std::to_string(result.threadID) + ",";
+			event += "\"ts\":" + std::to_string(result.start) + "}";
+			return event;
+		}
+
+		void write_header()
+		{
+			m_output_stream << "{\"otherData\": {},\"traceEvents\":[";
+			m_output_stream.flush();
+		}
+
+		void write_session_metadata()
+		{
+			std::string session = m_current_session->m_name;
+			std::replace(session.begin(), session.end(), '"', '\'');
+			std::string process = detail::process_name();
+			std::replace(process.begin(), process.end(), '"', '\'');
+			std::string host = detail::host_name();
+			std::replace(host.begin(), host.end(), '"', '\'');
+
+			long long monotonic_before = detail::monotonic_ns();
+			long long clock_ns = sch::duration_cast<sch::nanoseconds>(clock_t::now().time_since_epoch()).count();
+			long long monotonic_after = detail::monotonic_ns();
+			long long realtime_ns = sch::duration_cast<sch::nanoseconds>(sch::system_clock::now().time_since_epoch()).count();
+
+			m_output_stream << "{\"args\":{\"name\":\"" << process << " (" << m_pid << ")\"},\"cat\":\"__metadata\",\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << m_pid << ",\"tid\":0,\"ts\":0},";
+			m_output_stream << "{\"args\":{\"labels\":\"" << session << "\"},\"cat\":\"__metadata\",\"name\":\"process_labels\",\"ph\":\"M\",\"pid\":" << m_pid << ",\"tid\":0,\"ts\":0},";
+			m_output_stream << "{\"args\":{\"clock_ns\":" << clock_ns << ",\"monotonic_ns\":" << monotonic_before + (monotonic_after - monotonic_before) / 2
+				<< ",\"realtime_ns\":" << realtime_ns << ",\"ts_per_second\":" << time_units::milliseconds::type::period::den
+				<< ",\"host\":\"" << host << "\",\"process\":\"" << process << "\",\"session\":\"" << session << "\",\"pid\":" << m_pid
+				<< "},\"cat\":\"__metadata\",\"name\":\"coco_clock_anchor\",\"ph\":\"M\",\"pid\":" << m_pid << ",\"tid\":0,\"ts\":0}";
+			m_output_stream.flush();
+			m_profile_count += 3;
+		}
+
+		void write_footer()
+		{
+			m_output_stream << "]}";
+			m_output_stream.flush();
+		}
+	public:
+		static instrumentor& get()
+		{
+			static instrumentor instance;
+			return instance;
+		}
+
+	private:
+		std::mutex m_mutex;
+		detail::instrumentation_session* m_current_session;
+		std::ofstream m_output_stream;
+		int m_profile_count;
+		std::atomic<bool> m_active;
+		std::function<void(const detail::profile_result&)> m_scope_observer;
+		std::atomic<bool> m_has_observer{ false };
+		std::atomic<bool> m_cpu_tracking{ false };
+		std::string m_filepath;
+		long long m_pid;
+		std::atomic<bool> m_ctf{ false };
+		unsigned char m_ctf_uuid[16] = {};
+
+		std::mutex m_buffer_mutex;
+		event_buffer_options m_buffer_options;
+		std::vector<detail::event_buffer*> m_buffers;
+		std::vector<detail::compact_event_buffer*> m_compact_buffers;
+		std::atomic<bool> m_buffering{ false };
+		std::atomic<unsigned> m_generation{ 0 };
+	};
+
+	struct dont_start {};
+	struct cpu_time {};
+
+#ifndef COCO_MAX_TIMER_LAPS
+#define COCO_MAX_TIMER_LAPS 8
+#endif // COCO_MAX_TIMER_LAPS
+
+	struct timer_lap
+	{
+		const char* name;
+		long long time;
+	};
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	class timer
+	{
+	public:
+		timer(const std::string& name = std::string{ "Coco Timer" }, bool print_state = false) : m_name(name), m_print_when_stopped(print_state)
+		{
+			start();
+		}
+
+		timer(dont_start) : m_name(std::string{ "Coco Timer" }), m_print_when_stopped(false)
+		{
+			m_time = 0;
+			m_paused = false;
+			m_stopped = true;
+		}
+
+		~timer()
+		{
+			stop();
+		}
+
+		void start()
+		{
+			if (m_stopped)
+			{
+				m_time = 0;
+				m_paused = false;
+				m_stopped = false;
+				m_timepoint = now();
+				m_lap_time = 0;
+				m_lap_count = 0;
+			}
+		}
+
+		void pause()
+		{
+			COCO_ASSERT(!m_stopped, "pause() called on inactive timer.");
+			if (!m_stopped && !m_paused)
+			{
+				m_paused = true;
+				long long start = tp_cast(m_timepoint).time_since_epoch().count();
+				long long end = tp_cast(now()).time_since_epoch().count();
+				m_time += (end - start);
+			}
+		}
+
+		void resume()
+		{
+			if (m_paused)
+			{
+				m_paused = false;
+				m_timepoint = now();
+			}
+		}
+
+		void reset()
+		{
+			m_time = 0;
+			m_paused = false;
+			m_stopped = false;
+			m_timepoint = now();
+			m_lap_time = 0;
+			m_lap_count = 0;
+		}
+
+		long long lap(const char* name)
+		{
+			COCO_ASSERT(!m_stopped, "lap() called on inactive timer.");
+			COCO_ASSERT(m_lap_count < COCO_MAX_TIMER_LAPS, "lap capacity exceeded, define COCO_MAX_TIMER_LAPS to raise it.");
+			if (m_stopped || m_lap_count >= COCO_MAX_TIMER_LAPS)
+				return 0;
+			long long running = m_time;
+			if (!m_paused)
+				running += tp_cast(now()).time_since_epoch().count() - tp_cast(m_timepoint).time_since_epoch().count();
+			long long time = running - m_lap_time;
+			m_laps[m_lap_count++] = timer_lap{ name, time };
+			m_lap_time = running;
+			return time;
+		}
+
+		const timer_lap* get_laps() const noexcept
+		{
+			return m_laps;
+		}
+
+		size_t get_lap_count() const noexcept
+		{
+			return m_lap_count;
+		}
+
+		void stop()
+		{
+			if (!m_stopped)
+			{
+				m_stopped = true;
+				long long start = tp_cast(m_timepoint).time_since_epoch().count();
+				long long end = tp_cast(now()).time_since_epoch().count();
+
+				m_time += (end - start);
+				if (m_print_when_stopped)
+					std::cout << m_name << " : " << m_time << ' ' << _Duration::name << "\n";
+			}
+		}
+
+		bool complated_on_time(long long time) const noexcept
+		{
+			if (!m_stopped)
+				return false;
+			return time >= m_time;
+		}
+
+		bool is_running() const noexcept
+		{
+			return !m_stopped;
+		}
+
+		bool is_paused() const noexcept
+		{
+			return m_paused;
+		}
+
+		void set_print_state(bool state)
+		{
+			m_print_when_stopped = state;
+		}
+
+		bool is_printing() const noexcept
+		{
+			return m_print_when_stopped;
+		}
+
+		long long get_time() const
+		{
+			return m_time;
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _To _COCO_ENABLE_IF_DURATION_T(_To)>
+		long long get_casted_time() const
+		{
+			return duration_count_cast<_Duration, _To>(m_time);
+		}
+
+	private:
+		sch::time_point<clock_t> now()
+		{
+			return clock_t::now();
+		}
+
+		constexpr sch::time_point<clock_t, typename _Duration::type> tp_cast(const sch::time_point<clock_t>& tp)
+		{
+			return sch::time_point_cast<typename _Duration::type>(tp);
+		}
+
+		sch::time_point<clock_t> m_timepoint;
+		std::string m_name;
+		bool m_print_when_stopped;
+		long long m_time = 0;
+		bool m_stopped = true;
+		bool m_paused = false;
+		long long m_lap_time = 0;
+		size_t m_lap_count = 0;
+		timer_lap m_laps[COCO_MAX_TIMER_LAPS];
+	};
+
+	struct pod_timer
+	{
+		long long start_ticks = 0;
+		long long elapsed_ticks = 0;
+
+		void start() noexcept
+		{
+			start_ticks = now_ticks();
+		}
+
+		void stop() noexcept
+		{
+			elapsed_ticks += now_ticks() - start_ticks;
+		}
+
+		void reset() noexcept
+		{
+			start_ticks = 0;
+			elapsed_ticks = 0;
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _To = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_To)>
+		constexpr long long get_time() const noexcept
+		{
+			return ticks_to<_To>(elapsed_ticks);
+		}
+
+		static long long now_ticks() noexcept
+		{
+			return clock_t::now().time_since_epoch().count();
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _To _COCO_ENABLE_IF_DURATION_T(_To)>
+		static constexpr long long ticks_to(long long ticks) noexcept
+		{
+			using ratio = std::ratio_divide<clock_t::period, typename _To::type::period>;
+			return ticks * ratio::num / ratio::den;
+		}
+	};
+
+	static_assert(std::is_trivially_copyable_v<pod_timer> && std::is_standard_layout_v<pod_timer>, "pod_timer must stay trivially copyable");
+
+	template <typename T>
+	struct is_timer : std::false_type {};
+
+	template <typename _Duration>
+	struct is_timer<timer<_Duration>> : std::true_type {};
+
+	template <typename T>
+	COCO_INLINE constexpr bool is_timer_v = is_timer<T>::value;
+
+#ifdef __cpp_concepts
+	namespace detail
+	{
+		template <class _Duration>
+		concept timer_type = is_timer_v<_Duration>;
+	}
+
+#define _COCO_ENABLE_IF_TIMER_T(_Timer)
+#define _COCO_CONCEPT_TIMER_T detail::timer_type
+#else // __cpp_concepts
+#define _COCO_ENABLE_IF_TIMER_T(_Timer) , std::enable_if_t<is_timer_v<_Timer>, int> = 0
+#define _COCO_CONCEPT_TIMER_T class
+#endif // __cpp_concepts
+
+	namespace detail
+	{
+#ifndef COCO_MAX_SCOPE_DEPTH
+#define COCO_MAX_SCOPE_DEPTH 32
+#endif // COCO_MAX_SCOPE_DEPTH
+
+		static constexpr size_t scope_name_capacity = 64;
+
+		struct active_scope
+		{
+			char name[scope_name_capacity];
+			long long start;
+			unsigned long long id;
+			bool cpu_time;
+			std::uint16_t wait_tag;
+		};
+
+		// A scheduler wait slot keeps the tag of the scope that owns it above the accumulated
+		// wait, so a sampler holding an old snapshot cannot add into a newer scope at that depth.
+		static constexpr unsigned scheduler_wait_bits = 48;
+		static constexpr unsigned long long scheduler_wait_mask = (1ULL << scheduler_wait_bits) - 1;
+
+		struct scope_stack
+		{
+			std::atomic<unsigned> sequence{ 0 };
+			std::atomic<size_t> depth{ 0 };
+			size_t threadID = 0;
+			long long native_id = 0;
+			active_scope entries[COCO_MAX_SCOPE_DEPTH];
+			std::atomic<unsigned long long> scheduler_wait[COCO_MAX_SCOPE_DEPTH] = {};
+		};
+
+		inline scope_stack*& published_scope_stack() noexcept
+		{
+			static thread_local scope_stack* pointer = nullptr;
+			return pointer;
+		}
+
+		struct scope_stack_registry
+		{
+			std::mutex mutex;
+			std::vector<scope_stack*> stacks;
+
+			scope_stack_registry()
+			{
+				fork_registry::get().add(this,
+					[this]() { mutex.lock(); },
+					[this]() { mutex.unlock(); },
+					[this]()
+					{
+						scope_stack* own = published_scope_stack();
+						stacks.clear();
+						if (own)
+							stacks.push_back(own);
+						mutex.unlock();
+					},
+					fork_rank::registry);
+			}
+
+			~scope_stack_registry()
+			{
+				fork_registry::get().remove(this);
+			}
+
+			static scope_stack_registry& get()
+			{
+				static scope_stack_registry instance;
+				return instance;
+			}
+		};
+
+		struct thread_scope_stack
+		{
+			scope_stack stack;
+
+			thread_scope_stack()
+			{
+				stack.threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				stack.native_id = native_thread_id();
+				{
+					std::lock_guard<std::mutex> lock(scope_stack_registry::get().mutex);
+					scope_stack_registry::get().stacks.push_back(&stack);
+				}
+				published_scope_stack() = &stack;
+			}
+
+			~thread_scope_stack()
+			{
+				published_scope_stack() = nullptr;
+				std::lock_guard<std::mutex> lock(scope_stack_registry::get().mutex);
+				auto& stacks = scope_stack_registry::get().stacks;
+				stacks.erase(std::remove(stacks.begin(), stacks.end(), &stack), stacks.end());
+			}
+		};
+
+		inline std::atomic<int>& scope_tracking_users() noexcept
+		{
+			static std::atomic<int> users{ 0 };
+			return users;
+		}
+
+		inline scope_stack& current_scope_stack()
+		{
+			thread_local thread_scope_stack instance;
+			return instance.stack;
+		}
+
+		inline bool push_scope(std::string_view name, sch::time_point<clock_t> start, bool cpu_time = false)
+		{
+			if (scope_tracking_users().load(std::memory_order_relaxed) == 0)
+				return false;
+
+			scope_stack& stack = current_scope_stack();
+			size_t depth = stack.depth.load(std::memory_order_relaxed);
+			unsigned sequence = stack.sequence.load(std::memory_order_relaxed);
+			stack.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			if (depth < COCO_MAX_SCOPE_DEPTH)
+			{
+				active_scope& entry = stack.entries[depth];
+				size_t length = std::min(name.size(), scope_name_capacity - 1);
+				std::memcpy(entry.name, name.data(), length);
+				entry.name[length] = '\0';
+				entry.start = start.time_since_epoch().count();
+				entry.id = 14695981039346656037ULL;
+				for (size_t i = 0; i < length; ++i)
+					entry.id = (entry.id ^ static_cast<unsigned char>(entry.name[i])) * 1099511628211ULL;
+				entry.cpu_time = cpu_time;
+				entry.wait_tag = static_cast<std::uint16_t>(sequence >> 1);
+				stack.scheduler_wait[depth].store(static_cast<unsigned long long>(entry.wait_tag) << scheduler_wait_bits, std::memory_order_relaxed);
+			}
+			stack.depth.store(depth + 1, std::memory_order_relaxed);
+			stack.sequence.store(sequence + 2, std::memory_order_release);
+			return true;
+		}
+
+		inline long long current_scope_wait()
+		{
+			scope_stack& stack = current_scope_stack();
+			size_t depth = stack.depth.load(std::memory_order_relaxed);
+			if (depth == 0 || depth > COCO_MAX_SCOPE_DEPTH)
+				return 0;
+			return static_cast<long long>(stack.scheduler_wait[depth - 1].load(std::memory_order_relaxed) & scheduler_wait_mask);
+		}
+
+		inline void pop_scope()
+		{
+			scope_stack& stack = current_scope_stack();
+			unsigned sequence = stack.sequence.load(std::memory_order_relaxed);
+			stack.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			stack.depth.store(stack.depth.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+			stack.sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		inline bool read_scope_stack(const scope_stack& stack, std::vector<active_scope>& out)
+		{
+			for (int attempt = 0; attempt < 64; ++attempt)
+			{
+				unsigned before = stack.sequence.load(std::memory_order_acquire);
+				if (before & 1)
+					continue;
+				size_t depth = std::min<size_t>(stack.depth.load(std::memory_order_relaxed), COCO_MAX_SCOPE_DEPTH);
+				out.assign(stack.entries, stack.entries + depth);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (stack.sequence.load(std::memory_order_relaxed) == before)
+					return true;
+			}
+			return false;
+		}
+	}
+
+	class instrumentation_timer
+	{
+	public:
+		instrumentation_timer(const std::string& name) : m_name(name)
+		{
+			start();
+		}
+
+		instrumentation_timer(const std::string& name, dont_start) : m_name(name)
+		{
+			m_time = 0;
+			m_stopped = true;
+		}
+
+		instrumentation_timer(const std::string& name, cpu_time) : m_name(name), m_cpu_time(true)
+		{
+			start();
+		}
+
+		~instrumentation_timer()
+		{
+			stop();
+		}
+
+		void start()
+		{
+			detail::resume_after_fork();
+			if (m_tracked)
+				detail::pop_scope();
+			m_time = 0;
+			m_stopped = false;
+			if (m_cpu_time)
+				m_cpu_start = detail::thread_cpu_time_ns();
+			m_start_cpu = instrumentor::get().is_cpu_tracking() ? detail::current_cpu() : -1;
+			m_timepoint = now();
+			m_tracked = detail::push_scope(m_name, m_timepoint, m_cpu_time);
+			COCO_USDT_PROBE1(scope_begin, m_name.c_str());
+		}
+
+		void stop()
+		{
+			if (!m_stopped)
+			{
+				auto end_timepoint = clock_t::now();
+				std::string args;
+				if (m_cpu_time)
+				{
+					args = "\"cpu_ns\":" + std::to_string(detail::thread_cpu_time_ns() - m_cpu_start);
+					if (m_tracked)
+						args += ",\"run_queue_wait_ns\":" + std::to_string(detail::current_scope_wait());
+				}
+				if (m_tracked)
+				{
+					detail::pop_scope();
+					m_tracked = false;
+				}
+
+				long long start = tp_cast(m_timepoint).time_since_epoch().count();
+				long long end = tp_cast(end_timepoint).time_since_epoch().count();
+
+				m_time = end - start;
+
+				size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				COCO_USDT_PROBE3(scope_end, m_name.c_str(), threadID, sch::duration_cast<sch::nanoseconds>(end_timepoint - m_timepoint).count());
+				instrumentor::get().write_profile({ m_name, start, end, threadID, std::move(args), m_start_cpu, m_start_cpu >= 0 ? detail::current_cpu() : -1,
+					sch::duration_cast<sch::nanoseconds>(m_timepoint.time_since_epoch()).count(), sch::duration_cast<sch::nanoseconds>(end_timepoint.time_since_epoch()).count() });
+				m_stopped = true;
+			}
+		}
+
+		bool complated_on_time(long long time) const noexcept
+		{
+			if (!m_stopped)
+				return false;
 			return time >= m_time;
 		}
 
-		long long get_time() const
+		long long get_time() const
+		{
+			return m_time;
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _To _COCO_ENABLE_IF_DURATION_T(_To)>
+		long long get_casted_time() const
+		{
+			return duration_count_cast<time_units::milliseconds, _To>(m_time);
+		}
+
+	private:
+		sch::time_point<clock_t> now()
+		{
+			return clock_t::now();
+		}
+
+		constexpr sch::time_point<clock_t, typename time_units::milliseconds::type> tp_cast(const sch::time_point<clock_t>& tp)
+		{
+			return sch::time_point_cast<typename time_units::milliseconds::type>(tp);
+		}
+
+		sch::time_point<clock_t> m_timepoint;
+		std::string m_name;
+		long long m_time = 0;
+		long long m_cpu_start = 0;
+		int m_start_cpu = -1;
+		bool m_stopped = false;
+		bool m_tracked = false;
+		bool m_cpu_time = false;
+	};
+
+	inline std::uint32_t intern_name(std::string_view name)
+	{
+		return detail::name_table::get().intern(name);
+	}
+
+	namespace detail
+	{
+		// Compact scopes cache their name id in a function-local static, so only literals are accepted.
+		// Use COCO_PROFILE_DYNAMIC_SCOPE for names built at runtime.
+		template <size_t N>
+		inline std::uint32_t intern_literal(const char (&name)[N])
+		{
+			return intern_name(name);
+		}
+	}
+
+	class compact_instrumentation_timer
+	{
+	public:
+		explicit compact_instrumentation_timer(std::uint32_t name_id, const char* name = nullptr) : m_name_id(name_id), m_name(name)
+		{
+			detail::resume_after_fork();
+			m_start_cpu = instrumentor::get().is_cpu_tracking() ? detail::current_cpu() : -1;
+			m_timepoint = clock_t::now();
+			if (detail::scope_tracking_users().load(std::memory_order_relaxed) > 0)
+				m_tracked = detail::push_scope(detail::name_table::get().view(name_id), m_timepoint);
+		}
+
+		~compact_instrumentation_timer()
+		{
+			stop();
+		}
+
+		void stop()
+		{
+			if (!m_stopped)
+			{
+				auto end_timepoint = clock_t::now();
+				if (m_tracked)
+				{
+					detail::pop_scope();
+					m_tracked = false;
+				}
+				COCO_USDT_PROBE3(compact_scope_end, m_name ? m_name : detail::name_table::get().c_str(m_name_id), m_name_id, sch::duration_cast<sch::nanoseconds>(end_timepoint - m_timepoint).count());
+				instrumentor::get().write_compact(m_name_id, m_timepoint, end_timepoint, m_start_cpu, m_start_cpu >= 0 ? detail::current_cpu() : -1);
+				m_stopped = true;
+			}
+		}
+
+	private:
+		sch::time_point<clock_t> m_timepoint;
+		std::uint32_t m_name_id;
+		const char* m_name;
+		int m_start_cpu = -1;
+		bool m_stopped = false;
+		bool m_tracked = false;
+	};
+
+	namespace detail
+	{
+		inline long long nearest_rank(const std::vector<long long>& sorted, double quantile)
+		{
+			if (sorted.empty())
+				return 0;
+			double rank = std::ceil(quantile * static_cast<double>(sorted.size()));
+			size_t index = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+			return sorted[std::min(index, sorted.size() - 1)];
+		}
+
+		inline void append_integer(std::string& out, long long value)
+		{
+			char buffer[24];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			out.append(buffer, result.ptr);
+		}
+
+		inline void append_double(std::string& out, double value)
+		{
+			char buffer[32];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			out.append(buffer, result.ptr);
+		}
+
+		template <class _Duration>
+		constexpr double to_seconds(double value)
+		{
+			return value * static_cast<double>(_Duration::type::period::num) / static_cast<double>(_Duration::type::period::den);
+		}
+
+		template <class _From, class _To>
+		constexpr double duration_value_cast(double value)
+		{
+			return sch::duration_cast<sch::duration<double, typename _To::type::period>>(sch::duration<double, typename _From::type::period>(value)).count();
+		}
+	}
+
+	namespace detail
+	{
+		struct statistics_access;
+	}
+
+	class timer_statistics
+	{
+	public:
+		timer_statistics() = default;
+
+		timer_statistics(const timer_statistics& other) : m_measurements(other.copy_measurements()) {}
+
+		timer_statistics(timer_statistics&& other) noexcept
+		{
+			std::lock_guard<std::mutex> lock(other.m_mutex);
+			m_measurements = std::move(other.m_measurements);
+		}
+
+		timer_statistics& operator=(const timer_statistics& other)
+		{
+			if (this != &other)
+			{
+				std::vector<long long> measurements = other.copy_measurements();
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_measurements = std::move(measurements);
+			}
+			return *this;
+		}
+
+		void add_measurement(long long time)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_measurements.push_back(time);
+		}
+
+		void clear_measurements()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_measurements.clear();
+		}
+
+		std::vector<long long> copy_measurements() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_measurements;
+		}
+
+		timer_statistics snapshot() const
+		{
+			return timer_statistics(*this);
+		}
+
+		double calculate_average() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_measurements.empty())
+			{
+				COCO_ASSERT(false, "no measurements found");
+				return 0.0;
+			}
+			return average();
+		}
+
+		double calculate_variance() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_measurements.empty())
+			{
+				COCO_ASSERT(false, "no measurements found");
+				return 0.0;
+			}
+			double avg = average();
+			double variance = 0.0;
+			for (long long time : m_measurements)
+				variance += std::pow(time - avg, 2);
+			variance /= m_measurements.size();
+			return variance;
+		}
+
+		double calculate_standard_deviation() const
+		{
+			return std::sqrt(calculate_variance());
+		}
+
+		double calculate_median() const
+		{
+			std::vector<long long> sorted_measurements = copy_measurements();
+			if (sorted_measurements.empty())
+			{
+				COCO_ASSERT(false, "no measurements found");
+				return 0.0;
+			}
+			std::sort(sorted_measurements.begin(), sorted_measurements.end());
+			size_t n = sorted_measurements.size();
+			if (n % 2 == 0)
+				return static_cast<double>(sorted_measurements[n / 2 - 1] + sorted_measurements[n / 2]) / 2.0;
+			else
+				return static_cast<double>(sorted_measurements[n / 2]);
+		}
+
+		long long get_min_value() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_measurements.empty())
+			{
+				COCO_ASSERT(false, "no measurements found");
+				return 0;
+			}
+			return *std::min_element(m_measurements.begin(), m_measurements.end());
+		}
+
+		long long get_max_value() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_measurements.empty())
+			{
+				COCO_ASSERT(false, "no measurements found");
+				return 0;
+			}
+			return *std::max_element(m_measurements.begin(), m_measurements.end());
+		}
+
+		double calculate_percentile(double percentile) const
+		{
+			std::vector<long long> sorted_measurements = copy_measurements();
+			if (sorted_measurements.empty())
+			{
+				COCO_ASSERT(false, "no measurements found");
+				return 0.0;
+			}
+			std::sort(sorted_measurements.begin(), sorted_measurements.end());
+			return static_cast<double>(detail::nearest_rank(sorted_measurements, percentile / 100.0));
+		}
+
+		size_t get_measurement_count() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_measurements.size();
+		}
+
+	private:
+		friend struct detail::statistics_access;
+
+		double average() const
+		{
+			long long sum = std::accumulate(m_measurements.begin(), m_measurements.end(), 0LL);
+			return static_cast<double>(sum) / m_measurements.size();
+		}
+
+		mutable std::mutex m_mutex;
+		std::vector<long long> m_measurements;
+	};
+
+	namespace detail
+	{
+		struct statistics_access
+		{
+			static std::mutex& mutex(const timer_statistics& stats) noexcept
+			{
+				return stats.m_mutex;
+			}
+		};
+	}
+
+	namespace detail
+	{
+		inline void append_padded(std::string& out, long long value, int width)
+		{
+			char buffer[24];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			for (int i = static_cast<int>(result.ptr - buffer); i < width; ++i)
+				out.push_back('0');
+			out.append(buffer, result.ptr);
+		}
+
+		inline void append_iso8601(std::string& out, sch::system_clock::time_point time)
+		{
+			long long milliseconds = sch::duration_cast<sch::milliseconds>(time.time_since_epoch()).count();
+			long long days = milliseconds / 86400000;
+			long long remainder = milliseconds % 86400000;
+			if (remainder < 0)
+			{
+				remainder += 86400000;
+				--days;
+			}
+
+			days += 719468;
+			long long era = (days >= 0 ? days : days - 146096) / 146097;
+			long long day_of_era = days - era * 146097;
+			long long year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+			long long day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+			long long month_index = (5 * day_of_year + 2) / 153;
+			long long day = day_of_year - (153 * month_index + 2) / 5 + 1;
+			long long month = month_index < 10 ? month_index + 3 : month_index - 9;
+			long long year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+			append_padded(out, year, 4);
+			out.push_back('-');
+			append_padded(out, month, 2);
+			out.push_back('-');
+			append_padded(out, day, 2);
+			out.push_back('T');
+			append_padded(out, remainder / 3600000, 2);
+			out.push_back(':');
+			append_padded(out, remainder / 60000 % 60, 2);
+			out.push_back(':');
+			append_padded(out, remainder / 1000 % 60, 2);
+			out.push_back('.');
+			append_padded(out, remainder % 1000, 3);
+			out.push_back('Z');
+		}
+
+		inline void append_json_string(std::string& out, const std::string& value)
+		{
+			out.push_back('"');
+			for (char c : value)
+			{
+				switch (c)
+				{
+				case '"': out.append("\\\""); break;
+				case '\\': out.append("\\\\"); break;
+				case '\n': out.append("\\n"); break;
+				case '\r': out.append("\\r"); break;
+				case '\t': out.append("\\t"); break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						out.append("\\u00");
+						out.push_back("0123456789abcdef"[(c >> 4) & 0xF]);
+						out.push_back("0123456789abcdef"[c & 0xF]);
+					}
+					else
+					{
+						out.push_back(c);
+					}
+					break;
+				}
+			}
+			out.push_back('"');
+		}
+
+		inline void append_csv_field(std::string& out, const std::string& value)
+		{
+			if (value.find_first_of(",\"\n\r") == std::string::npos)
+			{
+				out.append(value);
+				return;
+			}
+			out.push_back('"');
+			for (char c : value)
+			{
+				if (c == '"')
+					out.push_back('"');
+				out.push_back(c);
+			}
+			out.push_back('"');
+		}
+
+		struct structured_summary
+		{
+			static constexpr const char* percentile_names[] = { "p50", "p90", "p95", "p99", "p999" };
+			static constexpr double percentiles[] = { 0.5, 0.9, 0.95, 0.99, 0.999 };
+
+			size_t count = 0;
+			double average = 0.0;
+			double variance = 0.0;
+			double standard_deviation = 0.0;
+			double median = 0.0;
+			long long min = 0;
+			long long max = 0;
+			long long percentile_values[5] = {};
+
+			structured_summary(const timer_statistics& stats, std::vector<long long>& scratch)
+			{
+				scratch = stats.copy_measurements();
+				count = scratch.size();
+				if (count == 0)
+					return;
+				std::sort(scratch.begin(), scratch.end());
+				average = static_cast<double>(std::accumulate(scratch.begin(), scratch.end(), 0LL)) / static_cast<double>(count);
+				for (long long time : scratch)
+					variance += (static_cast<double>(time) - average) * (static_cast<double>(time) - average);
+				variance /= static_cast<double>(count);
+				standard_deviation = std::sqrt(variance);
+				median = count % 2 == 0 ? static_cast<double>(scratch[count / 2 - 1] + scratch[count / 2]) / 2.0 : static_cast<double>(scratch[count / 2]);
+				min = scratch.front();
+				max = scratch.back();
+				for (size_t i = 0; i < 5; ++i)
+					percentile_values[i] = nearest_rank(scratch, percentiles[i]);
+			}
+		};
+
+		inline void append_statistics_json(std::string& out, const std::string& series, const char* unit, const std::string& host, const std::string& timestamp, const structured_summary& summary)
+		{
+			out.append("{\"series\":");
+			append_json_string(out, series);
+			out.append(",\"unit\":\"").append(unit);
+			out.append("\",\"host\":");
+			append_json_string(out, host);
+			out.append(",\"timestamp\":\"").append(timestamp);
+			out.append("\",\"count\":");
+			append_integer(out, static_cast<long long>(summary.count));
+			out.append(",\"average\":");
+			append_double(out, summary.average);
+			out.append(",\"variance\":");
+			append_double(out, summary.variance);
+			out.append(",\"standard_deviation\":");
+			append_double(out, summary.standard_deviation);
+			out.append(",\"median\":");
+			append_double(out, summary.median);
+			out.append(",\"min\":");
+			append_integer(out, summary.min);
+			out.append(",\"max\":");
+			append_integer(out, summary.max);
+			for (size_t i = 0; i < 5; ++i)
+			{
+				out.append(",\"").append(structured_summary::percentile_names[i]).append("\":");
+				append_integer(out, summary.percentile_values[i]);
+			}
+			out.append("}\n");
+		}
+
+		inline void append_statistics_csv_header(std::string& out)
+		{
+			out.append("series,unit,host,timestamp,count,average,variance,standard_deviation,median,min,max");
+			for (const char* name : structured_summary::percentile_names)
+				out.append(",").append(name);
+			out.push_back('\n');
+		}
+
+		inline void append_statistics_csv(std::string& out, const std::string& series, const char* unit, const std::string& host, const std::string& timestamp, const structured_summary& summary)
+		{
+			append_csv_field(out, series);
+			out.push_back(',');
+			out.append(unit).push_back(',');
+			append_csv_field(out, host);
+			out.push_back(',');
+			out.append(timestamp).push_back(',');
+			append_integer(out, static_cast<long long>(summary.count));
+			out.push_back(',');
+			append_double(out, summary.average);
+			out.push_back(',');
+			append_double(out, summary.variance);
+			out.push_back(',');
+			append_double(out, summary.standard_deviation);
+			out.push_back(',');
+			append_double(out, summary.median);
+			out.push_back(',');
+			append_integer(out, summary.min);
+			out.push_back(',');
+			append_integer(out, summary.max);
+			for (long long value : summary.percentile_values)
+			{
+				out.push_back(',');
+				append_integer(out, value);
+			}
+			out.push_back('\n');
+		}
+
+		inline bool write_structured(const std::filesystem::path& filepath, const std::string& data, bool append)
+		{
+			std::ofstream file(filepath, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+			if (!file.is_open())
+			{
+				COCO_ASSERT(false, "Failed to open file for writing.");
+				return false;
+			}
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+			return file.good();
+		}
+
+		template <class _Duration>
+		bool log_statistics_structured(const std::filesystem::path& filepath, const std::vector<std::pair<std::string, const timer_statistics*>>& series, bool append, bool csv)
+		{
+			std::string host = host_name();
+			std::string timestamp;
+			append_iso8601(timestamp, sch::system_clock::now());
+
+			std::string out;
+			std::vector<long long> scratch;
+			std::error_code error;
+			if (csv && (!append || !std::filesystem::exists(filepath, error) || std::filesystem::file_size(filepath, error) == 0))
+				append_statistics_csv_header(out);
+
+			for (const auto& entry : series)
+			{
+				structured_summary summary(*entry.second, scratch);
+				if (csv)
+					append_statistics_csv(out, entry.first, _Duration::name, host, timestamp, summary);
+				else
+					append_statistics_json(out, entry.first, _Duration::name, host, timestamp, summary);
+			}
+			return write_structured(filepath, out, append);
+		}
+	}
+
+	class timer_data_logger
+	{
+	public:
+		timer_data_logger() : m_stats(new timer_statistics()) {}
+
+		timer_data_logger(const timer_statistics& stats) : m_stats(new timer_statistics(stats)) {}
+
+		timer_data_logger(timer_statistics&& stats) noexcept : m_stats(new timer_statistics(std::move(stats))) {}
+
+		~timer_data_logger()
+		{
+			delete m_stats;
+		}
+
+		timer_statistics* get_statistics() const
+		{
+			return m_stats;
+		}
+
+		timer_data_logger& operator=(const timer_data_logger& other)
+		{
+			if (this != &other)
+			{
+				delete m_stats;
+				m_stats = new timer_statistics(*other.m_stats);
+			}
+			return *this;
+		}
+
+		timer_data_logger& operator=(timer_data_logger&& other) noexcept
+		{
+			if (this != &other)
+			{
+				delete m_stats;
+				m_stats = other.m_stats;
+				other.m_stats = nullptr;
+			}
+			return *this;
+		}
+
+		void add_measurement(long long time)
+		{
+			m_stats->add_measurement(time);
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void log_statistics(const std::filesystem::path& filepath)
+		{
+			std::ofstream file(filepath);
+			if (file.is_open())
+			{
+				file << "Statistics Summary:\n";
+				file << "-------------------\n";
+				file << "Number of attempts: " << m_stats->get_measurement_count() << " times\n";
+				file << "Average Time: " << m_stats->calculate_average() << ' ' << _Duration::name << "\n";
+				file << "Variance: " << m_stats->calculate_variance() << ' ' << _Duration::name << "\n";
+				file << "Standard Deviation: " << m_stats->calculate_standard_deviation() << ' ' << _Duration::name << "\n";
+				file << "Median Time: " << m_stats->calculate_median() << ' ' << _Duration::name << "\n";
+				file << "Minimum Time: " << m_stats->get_min_value() << ' ' << _Duration::name << "\n";
+				file << "Maximum Time: " << m_stats->get_max_value() << ' ' << _Duration::name << "\n";
+				file << "-------------------\n";
+				file.close();
+			}
+			else
+			{
+				COCO_ASSERT(false, "Failed to open file for writing.");
+			}
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		bool log_statistics_json(const std::filesystem::path& filepath, const std::string& series_name = "default", bool append = false)
+		{
+			return detail::log_statistics_structured<_Duration>(filepath, { { series_name, m_stats } }, append, false);
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		bool log_statistics_csv(const std::filesystem::path& filepath, const std::string& series_name = "default", bool append = false)
+		{
+			return detail::log_statistics_structured<_Duration>(filepath, { { series_name, m_stats } }, append, true);
+		}
+
+	private:
+		timer_statistics* m_stats;
+	};
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	bool log_statistics_json(const std::filesystem::path& filepath, const std::vector<std::pair<std::string, const timer_statistics*>>& series, bool append = false)
+	{
+		return detail::log_statistics_structured<_Duration>(filepath, series, append, false);
+	}
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	bool log_statistics_csv(const std::filesystem::path& filepath, const std::vector<std::pair<std::string, const timer_statistics*>>& series, bool append = false)
+	{
+		return detail::log_statistics_structured<_Duration>(filepath, series, append, true);
+	}
+
+	class lap_statistics
+	{
+	public:
+		template <_COCO_CONCEPT_DURATION_T _Duration _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_laps(const timer<_Duration>& timer)
+		{
+			const timer_lap* laps = timer.get_laps();
+			for (size_t i = 0; i < timer.get_lap_count(); ++i)
+				find_or_add(laps[i].name).add_measurement(laps[i].time);
+		}
+
+		const timer_statistics* get_statistics(const std::string& phase_name) const
+		{
+			for (const auto& phase : m_phases)
+			{
+				if (phase.first == phase_name)
+					return &phase.second;
+			}
+			COCO_ASSERT(false, "Phase not found!");
+			return nullptr;
+		}
+
+		template <class FunT>
+		void for_each_phase(FunT fun) const
+		{
+			for (const auto& phase : m_phases)
+				fun(phase.first, phase.second);
+		}
+
+		size_t get_phase_count() const noexcept
+		{
+			return m_phases.size();
+		}
+
+		void clear()
+		{
+			m_phases.clear();
+		}
+
+	private:
+		timer_statistics& find_or_add(const char* name)
+		{
+			for (auto& phase : m_phases)
+			{
+				if (phase.first == name)
+					return phase.second;
+			}
+			m_phases.emplace_back(name, timer_statistics{});
+			return m_phases.back().second;
+		}
+
+		std::vector<std::pair<std::string, timer_statistics>> m_phases;
+	};
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	class multiple_timer_manager
+	{
+	public:
+		multiple_timer_manager() {}
+
+		~multiple_timer_manager()
+		{
+			for (auto& timer : m_timers)
+				delete timer.second;
+		}
+
+		void add_and_start_timer(const std::string& timer_name)
+		{
+			if (m_timers.find(timer_name) == m_timers.end())
+				m_timers[timer_name] = new coco::timer<_Duration>();
+			COCO_ASSERT(false, "Timer already exists!");
+		}
+
+		void stop_timer(const std::string& timer_name)
+		{
+			if (m_timers.find(timer_name) != m_timers.end())
+			{
+				m_timers[timer_name]->stop();
+				m_data_logger.add_measurement(m_timers[timer_name]->get_time());
+			}
+			COCO_ASSERT(false, "Timer not found!");
+		}
+
+		void reset_timer(const std::string& timer_name)
+		{
+			if (m_timers.find(timer_name) != m_timers.end())
+				m_timers[timer_name]->reset();
+			COCO_ASSERT(false, "Timer not found!");
+		}
+
+		void pause_timer(const std::string& timer_name)
+		{
+			if (m_timers.find(timer_name) != m_timers.end())
+				m_timers[timer_name]->pause();
+			COCO_ASSERT(false, "Timer not found!");
+		}
+
+		void resume_timer(const std::string& timer_name)
+		{
+			if (m_timers.find(timer_name) != m_timers.end())
+				m_timers[timer_name]->resume();
+			COCO_ASSERT(false, "Timer not found!");
+		}
+
+		void remove_timer(const std::string& timer_name)
+		{
+			auto it = m_timers.find(timer_name);
+			if (it != m_timers.end())
+				m_timers.erase(it);
+			COCO_ASSERT(false, "Timer not found!");
+		}
+
+		void reset_all_timers()
+		{
+			for (auto& timer : m_timers)
+				timer.second->reset();
+		}
+
+		void stop_all_timers()
+		{
+			for (auto& timer : m_timers)
+				timer.second->stop();
+		}
+
+		coco::timer<_Duration>* get_timer(const std::string& timer_name)
+		{
+			auto it = m_timers.find(timer_name);
+			if (it != m_timers.end())
+				return m_timers.at(timer_name);
+			COCO_ASSERT(false, "Timer not found");
+			return nullptr;
+		}
+
+		void log_statistics(const std::filesystem::path& filepath)
+		{
+			m_data_logger.log_statistics<_Duration>(filepath);
+		}
+
+		bool log_statistics_json(const std::filesystem::path& filepath, const std::string& series_name = "default", bool append = false)
+		{
+			return m_data_logger.log_statistics_json<_Duration>(filepath, series_name, append);
+		}
+
+		bool log_statistics_csv(const std::filesystem::path& filepath, const std::string& series_name = "default", bool append = false)
+		{
+			return m_data_logger.log_statistics_csv<_Duration>(filepath, series_name, append);
+		}
+
+		const coco::timer_data_logger& get_data_logger() const
+		{
+			return m_data_logger;
+		}
+
+		template <class FunT>
+		void for_each_timer(FunT fun) const
+		{
+			for (const auto& timer : m_timers)
+				fun(timer.first, *timer.second);
+		}
+
+		bool is_timer_running(const std::string& timer_name) const
+		{
+			if (m_timers.find(timer_name) != m_timers.end())
+				return !m_timers.at(timer_name)->is_running();
+			COCO_ASSERT(false, "Timer not found!");
+			return false;
+		}
+
+		long long get_elapsed_time(const std::string& timer_name) const
+		{
+			if (m_timers.find(timer_name) != m_timers.end())
+				return m_timers.at(timer_name)->get_time();
+			COCO_ASSERT(false, "Timer not found!");
+			return 0;
+		}
+
+		void rename_timer(const std::string& old_name, const std::string& new_name)
+		{
+			if (m_timers.find(new_name) == m_timers.end())
+			{
+				auto it = m_timers.find(old_name);
+				if (it != m_timers.end())
+				{
+					m_timers[new_name] = std::move(it->second);
+					m_timers.erase(it);
+				}
+				COCO_ASSERT(false, "Timer not found!");
+			}
+			COCO_ASSERT(false, "New timer name already exists!");
+		}
+
+	private:
+		std::unordered_map<std::string, coco::timer<_Duration>*> m_timers;
+		coco::timer_data_logger m_data_logger;
+	};
+
+	class timer_controller
+	{
+	public:
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static void start_timer(_Timer& timer)
+		{
+			timer.start();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static void stop_timer(_Timer& timer)
+		{
+			timer.stop();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static void reset_timer(_Timer& timer)
+		{
+			timer.reset();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static void pause_timer(_Timer& timer)
+		{
+			timer.pause();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static void resume_timer(_Timer& timer)
+		{
+			timer.resume();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static bool is_timer_running(const _Timer& timer)
+		{
+			return timer.is_running();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static bool is_timer_paused(const _Timer& timer)
+		{
+			return timer.is_paused();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static long long get_timer_time(const _Timer& timer)
+		{
+			return timer.get_time();
+		}
+
+		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
+		static void set_timer_print_state(_Timer& timer, bool state)
+		{
+			timer.set_print_state(state);
+		}
+	};
+
+	template <class FunT, class ...Args>
+	void measure(size_t test_count, const std::filesystem::path& filepath, FunT fun, Args&&... args)
+	{
+		timer ctimer(dont_start{});
+		timer_data_logger measurement_stats;
+		for (size_t i = 0; i < test_count; ++i)
+		{
+			ctimer.start();
+			fun(args...);
+			ctimer.stop();
+			measurement_stats.add_measurement(ctimer.get_time());
+		}
+		measurement_stats.log_statistics(filepath);
+	}
+
+	namespace detail
+	{
+		static constexpr size_t stats_shard_count = 16;
+
+		inline size_t thread_shard_index() noexcept
+		{
+			static std::atomic<size_t> next_index{ 0 };
+			thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % stats_shard_count;
+			return index;
+		}
+
+		inline void atomic_store_min(std::atomic<long long>& target, long long value) noexcept
+		{
+			long long current = target.load(std::memory_order_relaxed);
+			while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+		}
+
+		inline void atomic_store_max(std::atomic<long long>& target, long long value) noexcept
+		{
+			long long current = target.load(std::memory_order_relaxed);
+			while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+		}
+	}
+
+	struct scope_stats_summary
+	{
+		const char* name;
+		unsigned long long count;
+		long long total;
+		long long min;
+		long long max;
+	};
+
+	class scope_stats_site
+	{
+	public:
+		explicit scope_stats_site(const char* name) : m_name(name)
+		{
+			m_next = head().load(std::memory_order_relaxed);
+			while (!head().compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		scope_stats_site(const scope_stats_site&) = delete;
+		scope_stats_site& operator=(const scope_stats_site&) = delete;
+
+		void add(long long nanoseconds) noexcept
+		{
+			shard& target = m_shards[detail::thread_shard_index()];
+			target.count.fetch_add(1, std::memory_order_relaxed);
+			target.total.fetch_add(nanoseconds, std::memory_order_relaxed);
+			detail::atomic_store_min(target.min, nanoseconds);
+			detail::atomic_store_max(target.max, nanoseconds);
+		}
+
+		scope_stats_summary summarize() const noexcept
+		{
+			scope_stats_summary summary{ m_name, 0, 0, std::numeric_limits<long long>::max(), 0 };
+			for (const shard& source : m_shards)
+			{
+				summary.count += source.count.load(std::memory_order_relaxed);
+				summary.total += source.total.load(std::memory_order_relaxed);
+				summary.min = std::min(summary.min, source.min.load(std::memory_order_relaxed));
+				summary.max = std::max(summary.max, source.max.load(std::memory_order_relaxed));
+			}
+			if (summary.count == 0)
+				summary.min = 0;
+			return summary;
+		}
+
+		void reset() noexcept
+		{
+			for (shard& target : m_shards)
+			{
+				target.count.store(0, std::memory_order_relaxed);
+				target.total.store(0, std::memory_order_relaxed);
+				target.min.store(std::numeric_limits<long long>::max(), std::memory_order_relaxed);
+				target.max.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		const char* get_name() const noexcept
+		{
+			return m_name;
+		}
+
+		template <class FunT>
+		static void for_each(FunT fun)
+		{
+			for (scope_stats_site* site = head().load(std::memory_order_acquire); site; site = site->m_next)
+				fun(*site);
+		}
+
+	private:
+		struct alignas(64) shard
+		{
+			std::atomic<unsigned long long> count{ 0 };
+			std::atomic<long long> total{ 0 };
+			std::atomic<long long> min{ std::numeric_limits<long long>::max() };
+			std::atomic<long long> max{ 0 };
+		};
+
+		static std::atomic<scope_stats_site*>& head() noexcept
+		{
+			static std::atomic<scope_stats_site*> instance{ nullptr };
+			return instance;
+		}
+
+		const char* m_name;
+		scope_stats_site* m_next = nullptr;
+		shard m_shards[detail::stats_shard_count];
+	};
+
+	class scope_stats_timer
+	{
+	public:
+		explicit scope_stats_timer(scope_stats_site& site) noexcept : m_site(site), m_start(clock_t::now()) {}
+
+		scope_stats_timer(const scope_stats_timer&) = delete;
+		scope_stats_timer& operator=(const scope_stats_timer&) = delete;
+
+		~scope_stats_timer()
+		{
+			m_site.add(sch::duration_cast<sch::nanoseconds>(clock_t::now() - m_start).count());
+		}
+
+	private:
+		scope_stats_site& m_site;
+		sch::time_point<clock_t> m_start;
+	};
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	void report_scope_stats(std::ostream& stream)
+	{
+		stream << "Scope Statistics:\n";
+		stream << "-------------------\n";
+		scope_stats_site::for_each([&](const scope_stats_site& site)
+			{
+				scope_stats_summary summary = site.summarize();
+				double average = summary.count > 0 ? static_cast<double>(summary.total) / static_cast<double>(summary.count) : 0.0;
+				stream << summary.name << ": " << summary.count << " times, total " << duration_count_cast<time_units::nanoseconds, _Duration>(summary.total)
+					<< ", average " << detail::duration_value_cast<time_units::nanoseconds, _Duration>(average)
+					<< ", min " << duration_count_cast<time_units::nanoseconds, _Duration>(summary.min)
+					<< ", max " << duration_count_cast<time_units::nanoseconds, _Duration>(summary.max) << ' ' << _Duration::name << "\n";
+			});
+		stream << "-------------------\n";
+	}
+
+	inline void reset_scope_stats()
+	{
+		scope_stats_site::for_each([](scope_stats_site& site) { site.reset(); });
+	}
+
+	class trace_args
+	{
+	public:
+		trace_args& add(const std::string& key, long long value)
+		{
+			append_key(key);
+			detail::append_integer(m_json, value);
+			return *this;
+		}
+
+		trace_args& add(const std::string& key, double value)
+		{
+			append_key(key);
+			if (std::isfinite(value))
+				detail::append_double(m_json, value);
+			else
+				m_json.append("null");
+			return *this;
+		}
+
+		trace_args& add(const std::string& key, const std::string& value)
+		{
+			append_key(key);
+			detail::append_json_string(m_json, value);
+			return *this;
+		}
+
+		trace_args& add(const std::string& key, const char* value)
+		{
+			return add(key, std::string{ value });
+		}
+
+		const std::string& str() const noexcept
+		{
+			return m_json;
+		}
+
+	private:
+		void append_key(const std::string& key)
+		{
+			if (!m_json.empty())
+				m_json.push_back(',');
+			detail::append_json_string(m_json, key);
+			m_json.push_back(':');
+		}
+
+		std::string m_json;
+	};
+
+	struct budget_violation
+	{
+		const char* name;
+		long long duration;
+		long long budget;
+		size_t threadID;
+		std::string args;
+	};
+
+	class budget_dispatcher
+	{
+	public:
+		using handler_t = std::function<void(const budget_violation&)>;
+
+		budget_dispatcher()
+		{
+			detail::fork_registry::get().add(this,
+				[this]() { m_mutex.lock(); },
+				[this]() { m_mutex.unlock(); },
+				[this]()
+				{
+					m_queue.clear();
+					if (m_thread.joinable())
+						detail::abandon_thread(m_thread);
+					m_mutex.unlock();
+				},
+				detail::fork_rank::component,
+				[this]()
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_running && !m_thread.joinable())
+						m_thread = std::thread([this]() { run(); });
+				});
+		}
+
+		~budget_dispatcher()
+		{
+			detail::fork_registry::get().remove(this);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_running = false;
+			}
+			m_cv.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
+		}
+
+		void set_handler(handler_t handler)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_handler = std::move(handler);
+			m_has_handler.store(static_cast<bool>(m_handler), std::memory_order_relaxed);
+			if (m_handler && !m_thread.joinable())
+			{
+				m_running = true;
+				m_thread = std::thread([this]() { run(); });
+			}
+		}
+
+		bool has_handler() const noexcept
+		{
+			return m_has_handler.load(std::memory_order_relaxed);
+		}
+
+		void post(budget_violation violation)
+		{
+			detail::resume_after_fork();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_handler)
+					return;
+				m_queue.push_back(std::move(violation));
+			}
+			m_cv.notify_one();
+		}
+
+		static budget_dispatcher& get()
+		{
+			static budget_dispatcher instance;
+			return instance;
+		}
+
+	private:
+		void run()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_running || !m_queue.empty())
+			{
+				m_cv.wait(lock, [this]() { return !m_running || !m_queue.empty(); });
+				std::vector<budget_violation> batch;
+				batch.swap(m_queue);
+				handler_t handler = m_handler;
+				lock.unlock();
+				for (const budget_violation& violation : batch)
+				{
+					if (handler)
+						handler(violation);
+				}
+				lock.lock();
+			}
+		}
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::vector<budget_violation> m_queue;
+		handler_t m_handler;
+		std::atomic<bool> m_has_handler{ false };
+		bool m_running = false;
+		std::thread m_thread;
+	};
+
+	class budget_site
+	{
+	public:
+		budget_site(const char* name, sch::nanoseconds budget) : m_stats(name), m_budget(budget.count())
+		{
+			m_next = head().load(std::memory_order_relaxed);
+			while (!head().compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		budget_site(const budget_site&) = delete;
+		budget_site& operator=(const budget_site&) = delete;
+
+		const char* get_name() const noexcept
+		{
+			return m_stats.get_name();
+		}
+
+		long long get_budget() const noexcept
+		{
+			return m_budget;
+		}
+
+		unsigned long long get_over_budget_count() const noexcept
+		{
+			return m_over_budget.load(std::memory_order_relaxed);
+		}
+
+		const scope_stats_site& get_statistics() const noexcept
+		{
+			return m_stats;
+		}
+
+		void reset() noexcept
+		{
+			m_stats.reset();
+			m_over_budget.store(0, std::memory_order_relaxed);
+		}
+
+		template <class FunT>
+		static void for_each(FunT fun)
+		{
+			for (budget_site* site = head().load(std::memory_order_acquire); site; site = site->m_next)
+				fun(*site);
+		}
+
+	private:
+		template <class _ArgsFn>
+		friend class budget_scope;
+
+		static std::atomic<budget_site*>& head() noexcept
+		{
+			static std::atomic<budget_site*> instance{ nullptr };
+			return instance;
+		}
+
+		scope_stats_site m_stats;
+		long long m_budget;
+		std::atomic<unsigned long long> m_over_budget{ 0 };
+		budget_site* m_next = nullptr;
+	};
+
+	namespace detail
+	{
+		struct no_trace_args
+		{
+			std::string operator()() const
+			{
+				return {};
+			}
+		};
+	}
+
+	template <class _ArgsFn = detail::no_trace_args>
+	class budget_scope
+	{
+	public:
+		budget_scope(budget_site& site, _ArgsFn args = _ArgsFn{}) : m_site(site), m_args(std::move(args)), m_start(clock_t::now()) {}
+
+		budget_scope(const budget_scope&) = delete;
+		budget_scope& operator=(const budget_scope&) = delete;
+
+		~budget_scope()
+		{
+			auto end = clock_t::now();
+			long long duration = sch::duration_cast<sch::nanoseconds>(end - m_start).count();
+			m_site.m_stats.add(duration);
+			COCO_USDT_PROBE3(budget_scope_end, m_site.get_name(), m_site.m_budget, duration);
+
+			if (duration > m_site.m_budget)
+				over_budget(duration, end);
+			else if (instrumentor::get().is_active())
+				write_profile(end, m_args());
+		}
+
+	private:
+		void over_budget(long long duration, sch::time_point<clock_t> end)
+		{
+			m_site.m_over_budget.fetch_add(1, std::memory_order_relaxed);
+			std::string args = m_args();
+			size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+			if (instrumentor::get().is_active())
+				write_profile(end, args);
+			if (budget_dispatcher::get().has_handler())
+				budget_dispatcher::get().post(budget_violation{ m_site.get_name(), duration, m_site.m_budget, threadID, std::move(args) });
+		}
+
+		void write_profile(sch::time_point<clock_t> end, std::string args)
+		{
+			long long start = sch::time_point_cast<time_units::milliseconds::type>(m_start).time_since_epoch().count();
+			long long stop = sch::time_point_cast<time_units::milliseconds::type>(end).time_since_epoch().count();
+			size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+			instrumentor::get().write_profile({ m_site.get_name(), start, stop, threadID, std::move(args), -1, -1,
+				sch::duration_cast<sch::nanoseconds>(m_start.time_since_epoch()).count(), sch::duration_cast<sch::nanoseconds>(end.time_since_epoch()).count() });
+		}
+
+		budget_site& m_site;
+		_ArgsFn m_args;
+		sch::time_point<clock_t> m_start;
+	};
+
+	template <class _ArgsFn>
+	budget_scope<_ArgsFn> make_budget_scope(budget_site& site, _ArgsFn args)
+	{
+		return budget_scope<_ArgsFn>(site, std::move(args));
+	}
+
+	inline void set_budget_handler(budget_dispatcher::handler_t handler)
+	{
+		budget_dispatcher::get().set_handler(std::move(handler));
+	}
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	void report_budget_stats(std::ostream& stream)
+	{
+		stream << "Budget Statistics:\n";
+		stream << "-------------------\n";
+		budget_site::for_each([&](const budget_site& site)
+			{
+				scope_stats_summary summary = site.get_statistics().summarize();
+				stream << summary.name << ": " << summary.count << " times, " << site.get_over_budget_count() << " over budget of "
+					<< duration_count_cast<time_units::nanoseconds, _Duration>(site.get_budget()) << ", max "
+					<< duration_count_cast<time_units::nanoseconds, _Duration>(summary.max) << ' ' << _Duration::name << "\n";
+			});
+		stream << "-------------------\n";
+	}
+
+	class rate_meter
+	{
+	public:
+		rate_meter() : m_created(clock_t::now()), m_last_tick(m_created)
+		{
+			detail::fork_registry::get().add(this,
+				[this]() { m_mutex.lock(); },
+				[this]() { m_mutex.unlock(); },
+				[this]() { m_mutex.unlock(); },
+				detail::fork_rank::statistics);
+		}
+
+		rate_meter(const rate_meter&) = delete;
+		rate_meter& operator=(const rate_meter&) = delete;
+
+		~rate_meter()
+		{
+			detail::fork_registry::get().remove(this);
+		}
+
+		void mark(unsigned long long count = 1) noexcept
+		{
+			m_shards[detail::thread_shard_index()].count.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		void tick()
+		{
+			tick(clock_t::now());
+		}
+
+		void tick(sch::time_point<clock_t> now)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			unsigned long long total = get_count();
+			double elapsed = sch::duration<double>(now - m_last_tick).count();
+			if (elapsed <= 0.0)
+				return;
+
+			double instant = static_cast<double>(total - m_last_total) / elapsed;
+			for (size_t i = 0; i < window_count; ++i)
+			{
+				if (!m_initialized)
+					m_rates[i] = instant;
+				else
+					m_rates[i] += (1.0 - std::exp(-elapsed / windows[i])) * (instant - m_rates[i]);
+			}
+			m_instant_rate = instant;
+			m_initialized = true;
+			m_last_total = total;
+			m_last_tick = now;
+		}
+
+		unsigned long long get_count() const noexcept
+		{
+			unsigned long long total = 0;
+			for (const shard& source : m_shards)
+				total += source.count.load(std::memory_order_relaxed);
+			return total;
+		}
+
+		double get_rate_1s() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_rates[0];
+		}
+
+		double get_rate_10s() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_rates[1];
+		}
+
+		double get_rate_60s() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_rates[2];
+		}
+
+		double get_instant_rate() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_instant_rate;
+		}
+
+		double get_mean_rate() const
+		{
+			double elapsed = sch::duration<double>(clock_t::now() - m_created).count();
+			return elapsed > 0.0 ? static_cast<double>(get_count()) / elapsed : 0.0;
+		}
+
+	private:
+		static constexpr size_t window_count = 3;
+		static constexpr double windows[window_count] = { 1.0, 10.0, 60.0 };
+
+		struct alignas(64) shard
+		{
+			std::atomic<unsigned long long> count{ 0 };
+		};
+
+		shard m_shards[detail::stats_shard_count];
+		mutable std::mutex m_mutex;
+		sch::time_point<clock_t> m_created;
+		sch::time_point<clock_t> m_last_tick;
+		unsigned long long m_last_total = 0;
+		double m_rates[window_count] = {};
+		double m_instant_rate = 0.0;
+		bool m_initialized = false;
+	};
+
+	class meter_ticker
+	{
+	public:
+		meter_ticker()
+		{
+			detail::fork_registry::get().add(this,
+				[this]() { m_mutex.lock(); },
+				[this]() { m_mutex.unlock(); },
+				[this]()
+				{
+					if (m_thread.joinable())
+						detail::abandon_thread(m_thread);
+					m_mutex.unlock();
+				},
+				detail::fork_rank::component,
+				[this]()
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_running && !m_thread.joinable())
+						launch();
+				});
+		}
+
+		meter_ticker(const meter_ticker&) = delete;
+		meter_ticker& operator=(const meter_ticker&) = delete;
+
+		~meter_ticker()
+		{
+			detail::fork_registry::get().remove(this);
+			stop();
+		}
+
+		void add(rate_meter& meter)
+		{
+			detail::resume_after_fork();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_meters.push_back(&meter);
+		}
+
+		void remove(rate_meter& meter)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_meters.erase(std::remove(m_meters.begin(), m_meters.end(), &meter), m_meters.end());
+		}
+
+		void start(sch::milliseconds interval = sch::seconds(1))
+		{
+			detail::resume_after_fork();
+			if (m_thread.joinable())
+			{
+				COCO_ASSERT(false, "meter ticker is already running");
+				return;
+			}
+			m_interval = interval;
+			m_running = true;
+			launch();
+		}
+
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_running = false;
+			}
+			m_cv.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
+		}
+
+	private:
+		void launch()
+		{
+			m_thread = std::thread([this]()
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					while (m_running)
+					{
+						m_cv.wait_for(lock, m_interval, [this]() { return !m_running; });
+						auto now = clock_t::now();
+						for (rate_meter* meter : m_meters)
+							meter->tick(now);
+					}
+				});
+		}
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::vector<rate_meter*> m_meters;
+		sch::milliseconds m_interval{ 0 };
+		bool m_running = false;
+		std::thread m_thread;
+	};
+
+	struct scope_frame
+	{
+		std::string name;
+		long long start;
+		long long elapsed;
+	};
+
+	struct stuck_scope
+	{
+		size_t threadID;
+		std::vector<scope_frame> stack;
+		size_t stuck_index;
+	};
+
+	class watchdog
+	{
+	public:
+		using handler_t = std::function<void(const stuck_scope&)>;
+
+		watchdog()
+		{
+			detail::fork_registry::get().add(this,
+				[this]() { m_mutex.lock(); },
+				[this]() { m_mutex.unlock(); },
+				[this]()
+				{
+					m_reported.clear();
+					if (m_thread.joinable())
+						detail::abandon_thread(m_thread);
+					m_mutex.unlock();
+				},
+				detail::fork_rank::component,
+				[this]()
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_running && !m_thread.joinable())
+						launch();
+				});
+		}
+
+		watchdog(const watchdog&) = delete;
+		watchdog& operator=(const watchdog&) = delete;
+
+		~watchdog()
+		{
+			detail::fork_registry::get().remove(this);
+			stop();
+		}
+
+		bool start(sch::nanoseconds threshold, handler_t handler = {}, sch::milliseconds interval = sch::milliseconds(100))
+		{
+			detail::resume_after_fork();
+			if (m_thread.joinable())
+			{
+				COCO_ASSERT(false, "watchdog is already running");
+				return false;
+			}
+			m_threshold = threshold;
+			m_handler = std::move(handler);
+			m_interval = interval;
+			m_running = true;
+			detail::scope_tracking_users().fetch_add(1, std::memory_order_relaxed);
+			launch();
+			return true;
+		}
+
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_running)
+					return;
+				m_running = false;
+			}
+			m_cv.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
+			detail::scope_tracking_users().fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void check()
+		{
+			long long now = clock_t::now().time_since_epoch().count();
+			std::vector<std::pair<size_t, long long>> reported;
+			std::vector<stuck_scope> stuck;
+			{
+				auto& registry = detail::scope_stack_registry::get();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				for (detail::scope_stack* stack : registry.stacks)
+				{
+					if (!detail::read_scope_stack(*stack, m_frames))
+						continue;
+					for (size_t i = 0; i < m_frames.size(); ++i)
+					{
+						long long elapsed = sch::duration_cast<sch::nanoseconds>(clock_t::duration(now - m_frames[i].start)).count();
+						if (elapsed < m_threshold.count())
+							continue;
+						reported.emplace_back(stack->threadID, m_frames[i].start);
+						if (std::find(m_reported.begin(), m_reported.end(), reported.back()) == m_reported.end())
+							stuck.push_back(make_report(stack->threadID, i, now));
+						break;
+					}
+				}
+			}
+			m_reported.swap(reported);
+
+			for (const stuck_scope& report : stuck)
+			{
+				if (instrumentor::get().is_active())
+				{
+					for (const scope_frame& frame : report.stack)
+					{
+						long long start = sch::time_point_cast<time_units::milliseconds::type>(sch::time_point<clock_t>(clock_t::duration(frame.start))).time_since_epoch().count();
+						instrumentor::get().write_begin({ frame.name, start, start, report.threadID, trace_args().add("watchdog_elapsed_ns", frame.elapsed).str() });
+					}
+				}
+				if (m_handler)
+					m_handler(report);
+			}
+		}
+
+	private:
+		void launch()
+		{
+			m_thread = std::thread([this]()
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					while (m_running)
+					{
+						m_cv.wait_for(lock, m_interval, [this]() { return !m_running; });
+						if (!m_running)
+							break;
+						lock.unlock();
+						check();
+						lock.lock();
+					}
+				});
+		}
+
+		stuck_scope make_report(size_t threadID, size_t stuck_index, long long now) const
+		{
+			stuck_scope report{ threadID, {}, stuck_index };
+			for (const detail::active_scope& frame : m_frames)
+				report.stack.push_back(scope_frame{ frame.name, frame.start, sch::duration_cast<sch::nanoseconds>(clock_t::duration(now - frame.start)).count() });
+			return report;
+		}
+
+		sch::nanoseconds m_threshold{ 0 };
+		handler_t m_handler;
+		std::vector<detail::active_scope> m_frames;
+		std::vector<std::pair<size_t, long long>> m_reported;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		sch::milliseconds m_interval{ 0 };
+		bool m_running = false;
+		std::thread m_thread;
+	};
+
+	struct thread_scheduler_stats
+	{
+		size_t threadID;
+		long long native_id;
+		unsigned long long run_ns;
+		unsigned long long wait_ns;
+		unsigned long long timeslices;
+	};
+
+	class schedstat_sampler
+	{
+	public:
+		schedstat_sampler()
+		{
+			detail::fork_registry::get().add(this,
+				[this]()
+				{
+					m_mutex.lock();
+					m_totals_mutex.lock();
+				},
+				[this]()
+				{
+					m_totals_mutex.unlock();
+					m_mutex.unlock();
+				},
+				[this]()
+				{
+					m_previous.clear();
+					m_totals.clear();
+					m_totals_mutex.unlock();
+					if (m_thread.joinable())
+						detail::abandon_thread(m_thread);
+					m_mutex.unlock();
+				},
+				detail::fork_rank::component,
+				[this]()
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_running && !m_thread.joinable())
+						launch();
+				});
+		}
+
+		schedstat_sampler(const schedstat_sampler&) = delete;
+		schedstat_sampler& operator=(const schedstat_sampler&) = delete;
+
+		~schedstat_sampler()
+		{
+			detail::fork_registry::get().remove(this);
+			stop();
+		}
+
+		bool start(sch::milliseconds interval = sch::milliseconds(10))
+		{
+			detail::resume_after_fork();
+			if (m_thread.joinable())
+			{
+				COCO_ASSERT(false, "schedstat sampler is already running");
+				return false;
+			}
+			m_interval = interval;
+			m_running = true;
+			detail::scope_tracking_users().fetch_add(1, std::memory_order_relaxed);
+			launch();
+			return true;
+		}
+
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_running)
+					return;
+				m_running = false;
+			}
+			m_cv.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
+			detail::scope_tracking_users().fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void sample()
+		{
+			std::vector<thread_scheduler_stats> deltas;
+			std::unordered_map<long long, detail::thread_schedstat> current;
+			{
+				auto& registry = detail::scope_stack_registry::get();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				for (detail::scope_stack* stack : registry.stacks)
+				{
+					detail::thread_schedstat stat;
+					if (!detail::read_schedstat(stack->native_id, stat))
+						continue;
+					current[stack->native_id] = stat;
+					auto previous = m_previous.find(stack->native_id);
+					if (previous == m_previous.end())
+						continue;
+
+					thread_scheduler_stats delta{ stack->threadID, stack->native_id, stat.run_ns - previous->second.run_ns,
+						stat.wait_ns - previous->second.wait_ns, stat.timeslices - previous->second.timeslices };
+					deltas.push_back(delta);
+					if (delta.wait_ns == 0 || !detail::read_scope_stack(*stack, m_frames))
+						continue;
+					for (size_t i = m_frames.size(); i-- > 0;)
+					{
+						if (m_frames[i].cpu_time)
+						{
+							std::atomic<unsigned long long>& slot = stack->scheduler_wait[i];
+							unsigned long long tag = static_cast<unsigned long long>(m_frames[i].wait_tag) << detail::scheduler_wait_bits;
+							unsigned long long value = slot.load(std::memory_order_relaxed);
+							while ((value & ~detail::scheduler_wait_mask) == tag && !slot.compare_exchange_weak(value, value + delta.wait_ns, std::memory_order_relaxed))
+							{
+							}
+							break;
+						}
+					}
+				}
+			}
+			m_previous.swap(current);
+
+			{
+				std::lock_guard<std::mutex> lock(m_totals_mutex);
+				for (const thread_scheduler_stats& delta : deltas)
+				{
+					thread_scheduler_stats& total = m_totals.emplace(delta.native_id, thread_scheduler_stats{ delta.threadID, delta.native_id, 0, 0, 0 }).first->second;
+					total.run_ns += delta.run_ns;
+					total.wait_ns += delta.wait_ns;
+					total.timeslices += delta.timeslices;
+				}
+			}
+
+			long long ts = sch::time_point_cast<time_units::milliseconds::type>(clock_t::now()).time_since_epoch().count();
+			for (const thread_scheduler_stats& delta : deltas)
+			{
+				std::string name = "run_queue_wait " + std::to_string(delta.native_id);
+				COCO_USDT_PROBE2(counter, name.c_str(), delta.wait_ns);
+				if (instrumentor::get().is_active())
+				{
+					instrumentor::get().write_counter({ name, ts, ts, delta.threadID, trace_args()
+						.add("waiting_ns", static_cast<long long>(delta.wait_ns))
+						.add("running_ns", static_cast<long long>(delta.run_ns)).str() });
+				}
+			}
+		}
+
+		std::vector<thread_scheduler_stats> get_thread_statistics() const
+		{
+			std::lock_guard<std::mutex> lock(m_totals_mutex);
+			std::vector<thread_scheduler_stats> result;
+			for (const auto& total : m_totals)
+				result.push_back(total.second);
+			std::sort(result.begin(), result.end(), [](const thread_scheduler_stats& lhs, const thread_scheduler_stats& rhs) { return lhs.wait_ns > rhs.wait_ns; });
+			return result;
+		}
+
+		void write_report(std::ostream& stream) const
+		{
+			stream << "Scheduler Summary:\n";
+			stream << "------------------\n";
+			for (const thread_scheduler_stats& stats : get_thread_statistics())
+			{
+				double waiting = stats.run_ns + stats.wait_ns > 0 ? 100.0 * static_cast<double>(stats.wait_ns) / static_cast<double>(stats.run_ns + stats.wait_ns) : 0.0;
+				stream << "Thread " << stats.native_id << ": " << stats.run_ns << " ns running, " << stats.wait_ns << " ns waiting ("
+					<< waiting << "% of runnable time), " << stats.timeslices << " timeslices\n";
+			}
+			stream << "------------------\n";
+		}
+
+	private:
+		void launch()
+		{
+			m_thread = std::thread([this]()
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					while (m_running)
+					{
+						m_cv.wait_for(lock, m_interval, [this]() { return !m_running; });
+						if (!m_running)
+							break;
+						lock.unlock();
+						sample();
+						lock.lock();
+					}
+				});
+		}
+
+		std::unordered_map<long long, detail::thread_schedstat> m_previous;
+		std::vector<detail::active_scope> m_frames;
+		mutable std::mutex m_totals_mutex;
+		std::unordered_map<long long, thread_scheduler_stats> m_totals;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		sch::milliseconds m_interval{ 0 };
+		bool m_running = false;
+		std::thread m_thread;
+	};
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	class labeled_timer_family
+	{
+	public:
+		using series_handle = size_t;
+
+		labeled_timer_family(const std::string& name, std::vector<std::string> label_names, size_t max_series = 1000)
+			: m_name(name), m_label_names(std::move(label_names)), m_max_series(max_series)
+		{
+			// Series never move once added, so record() indexes them without taking the family lock.
+			m_series.reserve(max_series + 1);
+			detail::fork_registry::get().add(this,
+				[this]()
+				{
+					m_mutex.lock();
+					for (series& entry : m_series)
+						detail::statistics_access::mutex(entry.stats).lock();
+				},
+				[this]() { unlock_all(); },
+				[this]() { unlock_all(); },
+				detail::fork_rank::statistics);
+		}
+
+		labeled_timer_family(const labeled_timer_family&) = delete;
+		labeled_timer_family& operator=(const labeled_timer_family&) = delete;
+
+		~labeled_timer_family()
+		{
+			detail::fork_registry::get().remove(this);
+		}
+
+		series_handle get_series(const std::vector<std::string>& label_values)
+		{
+			COCO_ASSERT(label_values.size() == m_label_names.size(), "label value count does not match label names");
+			std::string key;
+			for (const std::string& value : label_values)
+			{
+				key.append(value);
+				key.push_back('\0');
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_index.find(key);
+			if (it != m_index.end())
+				return it->second;
+
+			if (m_series.size() - (m_overflow_handle != invalid_handle ? 1 : 0) >= m_max_series)
+			{
+				if (m_overflow_handle == invalid_handle)
+				{
+					m_overflow_handle = m_series.size();
+					m_series.push_back(series{ std::vector<std::string>(m_label_names.size(), "__overflow__"), timer_statistics{} });
+					m_series_count.store(m_series.size(), std::memory_order_release);
+				}
+				return m_overflow_handle;
+			}
+
+			series_handle handle = m_series.size();
+			m_series.push_back(series{ label_values, timer_statistics{} });
+			m_series_count.store(m_series.size(), std::memory_order_release);
+			m_index.emplace(std::move(key), handle);
+			return handle;
+		}
+
+		void record(series_handle handle, long long time)
+		{
+			size_t count = m_series_count.load(std::memory_order_acquire);
+			COCO_ASSERT(handle < count, "invalid series handle");
+			if (handle < count)
+				m_series[handle].stats.add_measurement(time);
+		}
+
+		void record(series_handle handle, const timer<_Duration>& timer)
+		{
+			record(handle, timer.get_time());
+		}
+
+		timer_statistics get_statistics(series_handle handle) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_series[handle].stats.snapshot();
+		}
+
+		std::vector<std::string> get_label_values(series_handle handle) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_series[handle].label_values;
+		}
+
+		const std::vector<std::string>& get_label_names() const
+		{
+			return m_label_names;
+		}
+
+		const std::string& get_name() const
+		{
+			return m_name;
+		}
+
+		size_t get_series_count() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_series.size();
+		}
+
+		bool is_overflow(series_handle handle) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return handle == m_overflow_handle;
+		}
+
+	private:
+		static constexpr series_handle invalid_handle = static_cast<series_handle>(-1);
+
+		void unlock_all()
+		{
+			for (series& entry : m_series)
+				detail::statistics_access::mutex(entry.stats).unlock();
+			m_mutex.unlock();
+		}
+
+		struct series
+		{
+			std::vector<std::string> label_values;
+			timer_statistics stats;
+		};
+
+		std::string m_name;
+		std::vector<std::string> m_label_names;
+		size_t m_max_series;
+		mutable std::mutex m_mutex;
+		std::unordered_map<std::string, series_handle> m_index;
+		std::vector<series> m_series;
+		std::atomic<size_t> m_series_count{ 0 };
+		series_handle m_overflow_handle = invalid_handle;
+	};
+
+	class streaming_moments
+	{
+	public:
+		void add(double value)
+		{
+			++m_count;
+			double delta = value - m_mean;
+			m_mean += delta / static_cast<double>(m_count);
+			m_m2 += delta * (value - m_mean);
+			m_min = std::min(m_min, value);
+			m_max = std::max(m_max, value);
+		}
+
+		void merge(const streaming_moments& other)
+		{
+			if (other.m_count == 0)
+				return;
+			if (m_count == 0)
+			{
+				*this = other;
+				return;
+			}
+			double count = static_cast<double>(m_count + other.m_count);
+			double delta = other.m_mean - m_mean;
+			m_mean += delta * static_cast<double>(other.m_count) / count;
+			m_m2 += other.m_m2 + delta * delta * static_cast<double>(m_count) * static_cast<double>(other.m_count) / count;
+			m_count += other.m_count;
+			m_min = std::min(m_min, other.m_min);
+			m_max = std::max(m_max, other.m_max);
+		}
+
+		void assign(unsigned long long count, double mean, double m2, double min, double max)
+		{
+			m_count = count;
+			m_mean = mean;
+			m_m2 = m2;
+			m_min = min;
+			m_max = max;
+		}
+
+		unsigned long long get_count() const noexcept
+		{
+			return m_count;
+		}
+
+		double get_mean() const noexcept
+		{
+			return m_mean;
+		}
+
+		double get_m2() const noexcept
+		{
+			return m_m2;
+		}
+
+		double get_sum() const noexcept
+		{
+			return m_mean * static_cast<double>(m_count);
+		}
+
+		double get_variance() const noexcept
+		{
+			return m_count > 0 ? m_m2 / static_cast<double>(m_count) : 0.0;
+		}
+
+		double get_standard_deviation() const noexcept
+		{
+			return std::sqrt(get_variance());
+		}
+
+		double get_min() const noexcept
+		{
+			return m_count > 0 ? m_min : 0.0;
+		}
+
+		double get_max() const noexcept
+		{
+			return m_count > 0 ? m_max : 0.0;
+		}
+
+	private:
+		unsigned long long m_count = 0;
+		double m_mean = 0.0;
+		double m_m2 = 0.0;
+		double m_min = std::numeric_limits<double>::infinity();
+		double m_max = -std::numeric_limits<double>::infinity();
+	};
+
+	class quantile_sketch
+	{
+	public:
+		explicit quantile_sketch(double relative_accuracy = 0.01) : m_relative_accuracy(relative_accuracy)
+		{
+			if (!is_valid_accuracy(relative_accuracy))
+			{
+				COCO_ASSERT(false, "relative accuracy must be in (0, 1)");
+				m_relative_accuracy = relative_accuracy = 0.01;
+			}
+			double gamma = (1.0 + relative_accuracy) / (1.0 - relative_accuracy);
+			m_log_gamma = std::log(gamma);
+		}
+
+		static bool is_valid_accuracy(double relative_accuracy) noexcept
+		{
+			return std::isfinite(relative_accuracy) && relative_accuracy > 0.0 && relative_accuracy < 1.0;
+		}
+
+		void add(double value, unsigned long long count = 1)
+		{
+			if (value <= 0.0)
+				m_zero_count += count;
+			else
+				m_buckets[static_cast<int>(std::ceil(std::log(value) / m_log_gamma))] += count;
+			m_count += count;
+		}
+
+		void add_bucket(int index, unsigned long long count)
+		{
+			m_buckets[index] += count;
+			m_count += count;
+		}
+
+		bool merge(const quantile_sketch& other)
+		{
+			if (other.m_relative_accuracy != m_relative_accuracy)
+			{
+				COCO_ASSERT(false, "cannot merge sketches with different accuracy");
+				return false;
+			}
+			for (const auto& bucket : other.m_buckets)
+				m_buckets[bucket.first] += bucket.second;
+			m_zero_count += other.m_zero_count;
+			m_count += other.m_count;
+			return true;
+		}
+
+		double quantile(double quantile) const
+		{
+			if (m_count == 0)
+				return 0.0;
+			double rank = std::clamp(quantile, 0.0, 1.0) * static_cast<double>(m_count - 1);
+			unsigned long long seen = m_zero_count;
+			if (static_cast<double>(seen) > rank)
+				return 0.0;
+			for (const auto& bucket : m_buckets)
+			{
+				seen += bucket.second;
+				if (static_cast<double>(seen) > rank)
+					return 2.0 * std::exp(bucket.first * m_log_gamma) / (std::exp(m_log_gamma) + 1.0);
+			}
+			if (m_buckets.empty())
+				return 0.0;
+			return 2.0 * std::exp(m_buckets.rbegin()->first * m_log_gamma) / (std::exp(m_log_gamma) + 1.0);
+		}
+
+		double get_relative_accuracy() const noexcept
+		{
+			return m_relative_accuracy;
+		}
+
+		unsigned long long get_count() const noexcept
+		{
+			return m_count;
+		}
+
+		unsigned long long get_zero_count() const noexcept
+		{
+			return m_zero_count;
+		}
+
+		const std::map<int, unsigned long long>& get_buckets() const noexcept
+		{
+			return m_buckets;
+		}
+
+	private:
+		double m_relative_accuracy;
+		double m_log_gamma;
+		unsigned long long m_count = 0;
+		unsigned long long m_zero_count = 0;
+		std::map<int, unsigned long long> m_buckets;
+	};
+
+	struct statistics_snapshot
+	{
+		std::string name;
+		std::string unit;
+		streaming_moments moments;
+		quantile_sketch sketch;
+
+		void add(double value)
+		{
+			moments.add(value);
+			sketch.add(value);
+		}
+
+		bool merge(const statistics_snapshot& other)
+		{
+			if (unit != other.unit)
+			{
+				COCO_ASSERT(false, "cannot merge snapshots with different time units");
+				return false;
+			}
+			if (!sketch.merge(other.sketch))
+				return false;
+			moments.merge(other.moments);
+			return true;
+		}
+
+		double quantile(double quantile) const
+		{
+			return std::clamp(sketch.quantile(quantile), moments.get_min(), moments.get_max());
+		}
+	};
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	statistics_snapshot make_snapshot(const std::string& name, const timer_statistics& stats, double relative_accuracy = 0.01)
+	{
+		statistics_snapshot snapshot{ name, _Duration::name, streaming_moments{}, quantile_sketch{ relative_accuracy } };
+		for (long long time : stats.copy_measurements())
+			snapshot.add(static_cast<double>(time));
+		return snapshot;
+	}
+
+	namespace detail
+	{
+		static constexpr char snapshot_magic[8] = { 'C', 'O', 'C', 'O', 'S', 'N', 'A', 'P' };
+		static constexpr unsigned short snapshot_version = 1;
+
+		inline void put_fixed(std::string& out, unsigned long long value, size_t bytes)
+		{
+			for (size_t i = 0; i < bytes; ++i)
+				out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+		}
+
+		inline void put_double(std::string& out, double value)
+		{
+			unsigned long long bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			put_fixed(out, bits, 8);
+		}
+
+		inline void put_varint(std::string& out, unsigned long long value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+
+		inline void put_string(std::string& out, const std::string& value)
+		{
+			put_varint(out, value.size());
+			out.append(value);
+		}
+
+		class snapshot_reader
+		{
+		public:
+			snapshot_reader(const std::string& data) : m_data(data) {}
+
+			bool fixed(unsigned long long& value, size_t bytes)
+			{
+				if (m_position + bytes > m_data.size())
+					return false;
+				value = 0;
+				for (size_t i = 0; i < bytes; ++i)
+					value |= static_cast<unsigned long long>(static_cast<unsigned char>(m_data[m_position++])) << (8 * i);
+				return true;
+			}
+
+			bool real(double& value)
+			{
+				unsigned long long bits;
+				if (!fixed(bits, 8))
+					return false;
+				std::memcpy(&value, &bits, sizeof(value));
+				return true;
+			}
+
+			bool varint(unsigned long long& value)
+			{
+				value = 0;
+				for (int shift = 0; shift < 64 && m_position < m_data.size(); shift += 7)
+				{
+					unsigned char byte = static_cast<unsigned char>(m_data[m_position++]);
+					value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+					if (!(byte & 0x80))
+						return true;
+				}
+				return false;
+			}
+
+			bool string(std::string& value)
+			{
+				unsigned long long size;
+				if (!varint(size) || m_position + size > m_data.size())
+					return false;
+				value.assign(m_data, m_position, static_cast<size_t>(size));
+				m_position += static_cast<size_t>(size);
+				return true;
+			}
+
+		private:
+			const std::string& m_data;
+			size_t m_position = 0;
+		};
+	}
+
+	inline bool write_snapshots(const std::filesystem::path& filepath, const std::vector<statistics_snapshot>& snapshots)
+	{
+		std::string out(detail::snapshot_magic, sizeof(detail::snapshot_magic));
+		detail::put_fixed(out, detail::snapshot_version, 2);
+		detail::put_varint(out, snapshots.size());
+		for (const statistics_snapshot& snapshot : snapshots)
+		{
+			detail::put_string(out, snapshot.name);
+			detail::put_string(out, snapshot.unit);
+			detail::put_varint(out, snapshot.moments.get_count());
+			detail::put_double(out, snapshot.moments.get_mean());
+			detail::put_double(out, snapshot.moments.get_m2());
+			detail::put_double(out, snapshot.moments.get_min());
+			detail::put_double(out, snapshot.moments.get_max());
+			detail::put_double(out, snapshot.sketch.get_relative_accuracy());
+			detail::put_varint(out, snapshot.sketch.get_zero_count());
+			detail::put_varint(out, snapshot.sketch.get_buckets().size());
+			long long previous = 0;
+			for (const auto& bucket : snapshot.sketch.get_buckets())
+			{
+				long long delta = bucket.first - previous;
+				detail::put_varint(out, (static_cast<unsigned long long>(delta) << 1) ^ static_cast<unsigned long long>(delta >> 63));
+				detail::put_varint(out, bucket.second);
+				previous = bucket.first;
+			}
+		}
+
+		std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			COCO_ASSERT(false, "Failed to open file for writing.");
+			return false;
+		}
+		file.write(out.data(), static_cast<std::streamsize>(out.size()));
+		return file.good();
+	}
+
+	inline bool read_snapshots(const std::filesystem::path& filepath, std::vector<statistics_snapshot>& snapshots)
+	{
+		std::ifstream file(filepath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (data.size() < sizeof(detail::snapshot_magic) || data.compare(0, sizeof(detail::snapshot_magic), detail::snapshot_magic, sizeof(detail::snapshot_magic)) != 0)
+			return false;
+
+		detail::snapshot_reader reader(data);
+		unsigned long long skipped, version, count;
+		reader.fixed(skipped, sizeof(detail::snapshot_magic));
+		if (!reader.fixed(version, 2) || version != detail::snapshot_version || !reader.varint(count))
+			return false;
+
+		for (unsigned long long i = 0; i < count; ++i)
+		{
+			statistics_snapshot snapshot;
+			unsigned long long moment_count, zero_count, bucket_count;
+			double mean, m2, min, max, relative_accuracy;
+			if (!reader.string(snapshot.name) || !reader.string(snapshot.unit) || !reader.varint(moment_count) ||
+				!reader.real(mean) || !reader.real(m2) || !reader.real(min) || !reader.real(max) ||
+				!reader.real(relative_accuracy) || !quantile_sketch::is_valid_accuracy(relative_accuracy) || !reader.varint(zero_count) || !reader.varint(bucket_count))
+				return false;
+
+			snapshot.moments.assign(moment_count, mean, m2, min, max);
+			snapshot.sketch = quantile_sketch(relative_accuracy);
+			snapshot.sketch.add(0.0, zero_count);
+			long long index = 0;
+			for (unsigned long long b = 0; b < bucket_count; ++b)
+			{
+				unsigned long long zigzag, bucket_size;
+				if (!reader.varint(zigzag) || !reader.varint(bucket_size))
+					return false;
+				index += static_cast<long long>(zigzag >> 1) ^ -static_cast<long long>(zigzag & 1);
+				snapshot.sketch.add_bucket(static_cast<int>(index), bucket_size);
+			}
+			snapshots.push_back(std::move(snapshot));
+		}
+		return true;
+	}
+
+	inline bool read_trace_events(const std::filesystem::path& filepath, std::vector<std::string>& events)
+	{
+		std::ifstream file(filepath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		size_t position = data.find("\"traceEvents\"");
+		if (position == std::string::npos || (position = data.find('[', position)) == std::string::npos)
+			return false;
+
+		int depth = 0;
+		bool in_string = false;
+		size_t start = 0;
+		for (++position; position < data.size(); ++position)
+		{
+			char c = data[position];
+			if (in_string)
+			{
+				if (c == '\\')
+					++position;
+				else if (c == '"')
+					in_string = false;
+				continue;
+			}
+			if (c == '"')
+				in_string = true;
+			else if (c == '{' && depth++ == 0)
+				start = position;
+			else if (c == '}' && --depth == 0)
+				events.push_back(data.substr(start, position - start + 1));
+			else if (c == ']' && depth == 0)
+				break;
+		}
+		return true;
+	}
+
+	inline bool write_trace_events(const std::filesystem::path& filepath, const std::vector<std::string>& events)
+	{
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+		file << "{\"otherData\": {},\"traceEvents\":[";
+		for (size_t i = 0; i < events.size(); ++i)
+		{
+			if (i > 0)
+				file << ",";
+			file << events[i];
+		}
+		file << "]}";
+		return static_cast<bool>(file);
+	}
+
+	struct trace_clock_anchor
+	{
+		long long clock_ns = 0;
+		long long monotonic_ns = 0;
+		long long realtime_ns = 0;
+		long long ts_per_second = 1000;
+		long long pid = 0;
+		std::string host;
+		std::string process;
+		std::string session;
+	};
+
+	namespace detail
+	{
+		inline size_t find_json_value(const std::string& object, const char* key, bool last = false)
+		{
+			std::string pattern = std::string("\"") + key + "\"";
+			size_t position = last ? object.rfind(pattern) : object.find(pattern);
+			if (position == std::string::npos)
+				return std::string::npos;
+			position = object.find_first_not_of(" \t\r\n", position + pattern.size());
+			if (position == std::string::npos || object[position] != ':')
+				return std::string::npos;
+			return object.find_first_not_of(" \t\r\n", position + 1);
+		}
+
+		inline bool find_json_integer(const std::string& object, const char* key, long long& value, bool last = false)
+		{
+			size_t position = find_json_value(object, key, last);
+			if (position == std::string::npos)
+				return false;
+			return std::from_chars(object.data() + position, object.data() + object.size(), value).ec == std::errc();
+		}
+
+		inline bool find_json_string(const std::string& object, const char* key, std::string& value, bool last = false)
+		{
+			size_t position = find_json_value(object, key, last);
+			if (position == std::string::npos || object[position] != '"')
+				return false;
+			size_t end = object.find('"', position + 1);
+			if (end == std::string::npos)
+				return false;
+			value = object.substr(position + 1, end - position - 1);
+			return true;
+		}
+
+		inline bool is_metadata_event(const std::string& event)
+		{
+			std::string phase;
+			return find_json_string(event, "ph", phase) && phase == "M";
+		}
+
+		inline size_t find_json_object_end(const std::string& object, size_t position)
+		{
+			int depth = 0;
+			bool quoted = false;
+			for (; position < object.size(); ++position)
+			{
+				char c = object[position];
+				if (quoted)
+				{
+					if (c == '\\')
+						++position;
+					else if (c == '"')
+						quoted = false;
+				}
+				else if (c == '"')
+					quoted = true;
+				else if (c == '{' || c == '[')
+					++depth;
+				else if ((c == '}' || c == ']') && --depth == 0)
+					return position + 1;
+			}
+			return std::string::npos;
+		}
+
+		inline bool find_json_arg_integer(const std::string& event, const char* key, long long& value)
+		{
+			size_t begin = find_json_value(event, "args");
+			if (begin == std::string::npos || event[begin] != '{')
+				return false;
+			size_t end = find_json_object_end(event, begin);
+			if (end == std::string::npos)
+				return false;
+			std::string args = event.substr(begin, end - begin);
+			size_t position = find_json_value(args, key, true);
+			if (position == std::string::npos)
+				return false;
+			return std::from_chars(args.data() + position, args.data() + args.size(), value).ec == std::errc();
+		}
+
+		inline bool replace_json_integer(std::string& object, const char* key, long long value)
+		{
+			size_t position = find_json_value(object, key, true);
+			if (position == std::string::npos)
+				return false;
+			size_t end = object.find_first_not_of("-0123456789", position);
+			if (end == position || end == std::string::npos)
+				return false;
+			object.replace(position, end - position, std::to_string(value));
+			return true;
+		}
+	}
+
+	inline bool find_trace_anchor(const std::vector<std::string>& events, trace_clock_anchor& anchor)
+	{
+		for (const std::string& event : events)
+		{
+			if (!detail::is_metadata_event(event) || event.find("coco_clock_anchor") == std::string::npos)
+				continue;
+			bool valid = detail::find_json_integer(event, "clock_ns", anchor.clock_ns) &&
+				detail::find_json_integer(event, "monotonic_ns", anchor.monotonic_ns) &&
+				detail::find_json_integer(event, "realtime_ns", anchor.realtime_ns) &&
+				detail::find_json_integer(event, "pid", anchor.pid);
+			detail::find_json_integer(event, "ts_per_second", anchor.ts_per_second);
+			detail::find_json_string(event, "host", anchor.host);
+			detail::find_json_string(event, "process", anchor.process);
+			detail::find_json_string(event, "session", anchor.session);
+			return valid;
+		}
+		return false;
+	}
+
+	inline long long trace_alignment_ns(const trace_clock_anchor& reference, const trace_clock_anchor& anchor)
+	{
+		if (anchor.host == reference.host)
+			return (anchor.monotonic_ns - anchor.clock_ns) - (reference.monotonic_ns - reference.clock_ns);
+		return (anchor.realtime_ns - anchor.clock_ns) - (reference.realtime_ns - reference.clock_ns);
+	}
+
+	inline bool shift_trace_event(std::string& event, long long shift)
+	{
+		if (shift == 0 || detail::is_metadata_event(event))
+			return true;
+		size_t position = detail::find_json_value(event, "ts", true);
+		if (position == std::string::npos)
+			return false;
+		long long ts;
+		auto result = std::from_chars(event.data() + position, event.data() + event.size(), ts);
+		if (result.ec != std::errc())
+			return false;
+		size_t length = static_cast<size_t>(result.ptr - (event.data() + position));
+		event.replace(position, length, std::to_string(ts + shift));
+		return true;
+	}
+
+	struct scope_migration_stats
+	{
+		std::string name;
+		size_t scopes = 0;
+		size_t migrated = 0;
+	};
+
+	inline bool cpu_track_event(std::string& event)
+	{
+		long long cpu, pid;
+		std::string phase;
+		if (!detail::find_json_string(event, "ph", phase, true) || phase != "X" || !detail::find_json_arg_integer(event, "cpu", cpu) || cpu < 0 || !detail::find_json_integer(event, "pid", pid, true))
+			return false;
+		if (!detail::replace_json_integer(event, "pid", cpu))
+			return false;
+		size_t args = detail::find_json_value(event, "args");
+		event.insert(args + 1, "\"process\":" + std::to_string(pid) + (event[args + 1] == '}' ? "" : ","));
+		return true;
+	}
+
+	inline std::vector<std::string> cpu_track_layout(const std::vector<std::string>& events)
+	{
+		struct thread_track
+		{
+			long long cpu;
+			long long pid;
+			std::string tid;
+		};
+
+		std::vector<std::string> metadata;
+		std::vector<std::string> result;
+		std::vector<long long> cpus;
+		std::vector<thread_track> threads;
+		std::unordered_map<std::string, std::vector<std::string>> thread_metadata;
+		auto thread_key = [](long long pid, const std::string& tid) { return std::to_string(pid) + ":" + tid; };
+		auto tid_of = [](const std::string& event)
+			{
+				size_t position = detail::find_json_value(event, "tid", true);
+				return position == std::string::npos ? std::string() : event.substr(position, event.find_first_of(",}", position) - position);
+			};
+
+		for (const std::string& source : events)
+		{
+			std::string event = source;
+			long long pid = 0, cpu = 0;
+			if (detail::is_metadata_event(event))
+			{
+				std::string name;
+				if (detail::find_json_string(event, "name", name, true) && (name == "thread_name" || name == "thread_sort_index") && detail::find_json_integer(event, "pid", pid, true))
+					thread_metadata[thread_key(pid, tid_of(event))].push_back(event);
+				metadata.push_back(std::move(event));
+				continue;
+			}
+			if (detail::find_json_integer(event, "pid", pid, true) && cpu_track_event(event) && detail::find_json_arg_integer(event, "cpu", cpu))
+			{
+				std::string tid = tid_of(event);
+				if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end())
+					cpus.push_back(cpu);
+				if (std::find_if(threads.begin(), threads.end(), [&](const thread_track& track) { return track.cpu == cpu && track.pid == pid && track.tid == tid; }) == threads.end())
+					threads.push_back(thread_track{ cpu, pid, tid });
+			}
+			result.push_back(std::move(event));
+		}
+
+		std::sort(cpus.begin(), cpus.end());
+		for (long long cpu : cpus)
+		{
+			std::string id = std::to_string(cpu);
+			metadata.push_back("{\"args\":{\"name\":\"CPU " + id + "\"},\"cat\":\"__metadata\",\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + id + ",\"tid\":0,\"ts\":0}");
+			metadata.push_back("{\"args\":{\"sort_index\":" + id + "},\"cat\":\"__metadata\",\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" + id + ",\"tid\":0,\"ts\":0}");
+		}
+		for (const thread_track& track : threads)
+		{
+			auto entries = thread_metadata.find(thread_key(track.pid, track.tid));
+			if (entries == thread_metadata.end())
+				continue;
+			for (std::string entry : entries->second)
+			{
+				detail::replace_json_integer(entry, "pid", track.cpu);
+				metadata.push_back(std::move(entry));
+			}
+		}
+		metadata.insert(metadata.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+		return metadata;
+	}
+
+	inline std::vector<scope_migration_stats> count_cpu_migrations(const std::vector<std::string>& events)
+	{
+		std::vector<scope_migration_stats> result;
+		std::unordered_map<std::string, size_t> index;
+		for (const std::string& event : events)
+		{
+			long long cpu, end_cpu;
+			std::string name;
+			if (detail::is_metadata_event(event) || !detail::find_json_arg_integer(event, "cpu", cpu) || !detail::find_json_arg_integer(event, "end_cpu", end_cpu)
+				|| !detail::find_json_string(event, "name", name, true))
+				continue;
+			auto it = index.find(name);
+			if (it == index.end())
+			{
+				it = index.emplace(name, result.size()).first;
+				result.push_back(scope_migration_stats{ name, 0, 0 });
+			}
+			++result[it->second].scopes;
+			if (cpu != end_cpu)
+				++result[it->second].migrated;
+		}
+		std::sort(result.begin(), result.end(), [](const scope_migration_stats& lhs, const scope_migration_stats& rhs) { return lhs.migrated > rhs.migrated; });
+		return result;
+	}
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	class cadence_tracker
+	{
+	public:
+		cadence_tracker(const std::string& name, sch::nanoseconds target_period, double tolerance = 0.0)
+			: m_name(name), m_target_period(target_period.count()), m_tolerance(tolerance) {}
+
+		void tick()
+		{
+			tick(clock_t::now());
+		}
+
+		void tick(sch::time_point<clock_t> timepoint)
+		{
+			long long now = timepoint.time_since_epoch().count();
+			if (m_tick_count++ == 0)
+			{
+				m_last_tick = now;
+				return;
+			}
+
+			long long interval = sch::duration_cast<sch::nanoseconds>(clock_t::duration(now - m_last_tick)).count();
+			m_last_tick = now;
+
+			double interval_value = detail::duration_value_cast<time_units::nanoseconds, _Duration>(static_cast<double>(interval));
+			m_intervals.add(interval_value);
+			m_interval_sketch.add(interval_value);
+			m_deviations.add(detail::duration_value_cast<time_units::nanoseconds, _Duration>(static_cast<double>(interval - m_target_period)));
+
+			if (static_cast<double>(interval) > static_cast<double>(m_target_period) * (1.0 + m_tolerance))
+			{
+				++m_missed_deadlines;
+				if (m_target_period > 0)
+					m_missed_periods += static_cast<unsigned long long>(interval / m_target_period) - (interval % m_target_period == 0 ? 1 : 0);
+			}
+
+			COCO_USDT_PROBE2(counter, m_name.c_str(), interval);
+			if (m_trace_counter && instrumentor::get().is_active())
+			{
+				long long ts = sch::time_point_cast<time_units::milliseconds::type>(timepoint).time_since_epoch().count();
+				size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				instrumentor::get().write_counter({ m_name, ts, ts, threadID, trace_args().add(_Duration::name, interval_value).str() });
+			}
+		}
+
+		void set_trace_counter(bool state) noexcept
+		{
+			m_trace_counter = state;
+		}
+
+		void reset()
+		{
+			m_tick_count = 0;
+			m_missed_deadlines = 0;
+			m_missed_periods = 0;
+			m_intervals = streaming_moments{};
+			m_deviations = streaming_moments{};
+			m_interval_sketch = quantile_sketch{ m_interval_sketch.get_relative_accuracy() };
+		}
+
+		const streaming_moments& get_interval_statistics() const noexcept
+		{
+			return m_intervals;
+		}
+
+		const streaming_moments& get_deviation_statistics() const noexcept
+		{
+			return m_deviations;
+		}
+
+		const quantile_sketch& get_interval_histogram() const noexcept
+		{
+			return m_interval_sketch;
+		}
+
+		double get_interval_percentile(double percentile) const
+		{
+			return std::clamp(m_interval_sketch.quantile(percentile / 100.0), m_intervals.get_min(), m_intervals.get_max());
+		}
+
+		unsigned long long get_tick_count() const noexcept
+		{
+			return m_tick_count;
+		}
+
+		unsigned long long get_missed_deadline_count() const noexcept
+		{
+			return m_missed_deadlines;
+		}
+
+		unsigned long long get_missed_period_count() const noexcept
+		{
+			return m_missed_periods;
+		}
+
+		void log_statistics(std::ostream& stream) const
+		{
+			stream << "Cadence Summary (" << m_name << "):\n";
+			stream << "-------------------\n";
+			stream << "Number of ticks: " << m_tick_count << " times\n";
+			stream << "Target Period: " << detail::duration_value_cast<time_units::nanoseconds, _Duration>(static_cast<double>(m_target_period)) << ' ' << _Duration::name << "\n";
+			stream << "Average Interval: " << m_intervals.get_mean() << ' ' << _Duration::name << "\n";
+			stream << "Jitter (Standard Deviation): " << m_intervals.get_standard_deviation() << ' ' << _Duration::name << "\n";
+			stream << "Average Deviation: " << m_deviations.get_mean() << ' ' << _Duration::name << "\n";
+			stream << "Minimum Interval: " << m_intervals.get_min() << ' ' << _Duration::name << "\n";
+			stream << "99th Percentile Interval: " << get_interval_percentile(99.0) << ' ' << _Duration::name << "\n";
+			stream << "Maximum Interval: " << m_intervals.get_max() << ' ' << _Duration::name << "\n";
+			stream << "Missed Deadlines: " << m_missed_deadlines << " times (" << m_missed_periods << " periods skipped)\n";
+			stream << "-------------------\n";
+		}
+
+	private:
+		std::string m_name;
+		long long m_target_period;
+		double m_tolerance;
+		bool m_trace_counter = true;
+		long long m_last_tick = 0;
+		unsigned long long m_tick_count = 0;
+		unsigned long long m_missed_deadlines = 0;
+		unsigned long long m_missed_periods = 0;
+		streaming_moments m_intervals;
+		streaming_moments m_deviations;
+		quantile_sketch m_interval_sketch;
+	};
+
+	struct frame_record
+	{
+		unsigned long long index;
+		long long start;
+		double duration;
+		double scope_total;
+		std::vector<std::pair<std::string, double>> breakdown;
+	};
+
+	class frame_profiler
+	{
+	public:
+		frame_profiler()
+		{
+			detail::fork_registry::get().add(this,
+				[this]() { m_mutex.lock(); },
+				[this]() { m_mutex.unlock(); },
+				[this]() { m_mutex.unlock(); },
+				detail::fork_rank::statistics);
+		}
+
+		frame_profiler(const frame_profiler&) = delete;
+		frame_profiler& operator=(const frame_profiler&) = delete;
+
+		~frame_profiler()
+		{
+			detail::fork_registry::get().remove(this);
+		}
+
+		void enable(size_t slowest_count = 10, size_t history_count = 1024)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_slowest_count = slowest_count;
+				if (history_count != m_history_count)
+				{
+					m_frames = ordered_frames();
+					if (m_frames.size() > history_count)
+						m_frames.erase(m_frames.begin(), m_frames.end() - static_cast<std::ptrdiff_t>(history_count));
+					m_oldest_frame = 0;
+					m_history_count = history_count;
+				}
+				m_enabled = true;
+				m_frame_start = clock_t::now();
+			}
+			instrumentor::get().set_scope_observer([this](const detail::profile_result& result) { record_scope(result); });
+		}
+
+		void disable()
+		{
+			instrumentor::get().set_scope_observer({});
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_enabled = false;
+		}
+
+		void mark_frame()
+		{
+			auto now = clock_t::now();
+			long long ts = sch::time_point_cast<time_units::milliseconds::type>(now).time_since_epoch().count();
+			unsigned long long index;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				index = m_frame_index++;
+				if (m_enabled)
+					finish_frame(index, now);
+				m_frame_start = now;
+			}
+
+			if (instrumentor::get().is_active())
+			{
+				std::string name = "Frame " + std::to_string(index);
+				size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				instrumentor::get().write_instant({ name, ts, ts, threadID, trace_args().add("frame", static_cast<long long>(index)).str() });
+			}
+		}
+
+		void reset()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_frames.clear();
+			m_oldest_frame = 0;
+			m_slowest.clear();
+			m_current.clear();
+			m_frame_times = streaming_moments{};
+			m_frame_sketch = quantile_sketch{};
+			m_frame_index = 0;
+			m_frame_start = clock_t::now();
+		}
+
+		std::vector<frame_record> get_frames() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return ordered_frames();
+		}
+
+		std::vector<frame_record> get_slowest_frames() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::vector<frame_record> slowest = m_slowest;
+			std::sort(slowest.begin(), slowest.end(), [](const frame_record& lhs, const frame_record& rhs) { return lhs.duration > rhs.duration; });
+			return slowest;
+		}
+
+		void write_report(std::ostream& stream, bool include_all_frames = false) const
+		{
+			std::vector<frame_record> slowest = get_slowest_frames();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			stream << "Frame Summary:\n";
+			stream << "-------------------\n";
+			stream << "Number of frames: " << m_frame_times.get_count() << " frames\n";
+			stream << "Average Frame Time: " << m_frame_times.get_mean() << " milliseconds\n";
+			stream << "Standard Deviation: " << m_frame_times.get_standard_deviation() << " milliseconds\n";
+			stream << "Minimum Frame Time: " << m_frame_times.get_min() << " milliseconds\n";
+			stream << "Maximum Frame Time: " << m_frame_times.get_max() << " milliseconds\n";
+			for (double percentile : { 50.0, 90.0, 99.0 })
+			{
+				double value = std::clamp(m_frame_sketch.quantile(percentile / 100.0), m_frame_times.get_min(), m_frame_times.get_max());
+				stream << "P" << percentile << " Frame Time: " << value << " milliseconds\n";
+			}
+
+			stream << "Frame Time Histogram:\n";
+			write_histogram(stream);
+
+			stream << "Slowest Frames:\n";
+			for (const frame_record& frame : slowest)
+			{
+				stream << "  Frame " << frame.index << ": " << frame.duration << " milliseconds (" << frame.scope_total << " milliseconds in scopes)\n";
+				for (const auto& scope : frame.breakdown)
+					stream << "    " << scope.first << ": " << scope.second << " milliseconds\n";
+			}
+
+			if (include_all_frames)
+			{
+				stream << "Frame Totals:\n";
+				for (const frame_record& frame : ordered_frames())
+					stream << "  Frame " << frame.index << ": " << frame.duration << " milliseconds (" << frame.scope_total << " milliseconds in scopes)\n";
+			}
+			stream << "-------------------\n";
+		}
+
+		static frame_profiler& get()
+		{
+			static frame_profiler instance;
+			return instance;
+		}
+
+	private:
+		void record_scope(const detail::profile_result& result)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_enabled)
+				m_current[result.name] += static_cast<double>(result.end_ns - result.start_ns) / 1e6;
+		}
+
+		void finish_frame(unsigned long long index, sch::time_point<clock_t> now)
+		{
+			frame_record record{ index, sch::time_point_cast<time_units::milliseconds::type>(m_frame_start).time_since_epoch().count(),
+				sch::duration<double, std::milli>(now - m_frame_start).count(), 0.0, {} };
+			for (const auto& scope : m_current)
+				record.scope_total += scope.second;
+
+			m_frame_times.add(record.duration);
+			m_frame_sketch.add(record.duration);
+			if (m_frames.size() < m_history_count)
+			{
+				m_frames.push_back(record);
+			}
+			else if (m_history_count > 0)
+			{
+				m_frames[m_oldest_frame] = record;
+				m_oldest_frame = (m_oldest_frame + 1) % m_history_count;
+			}
+
+			auto slower = [](const frame_record& lhs, const frame_record& rhs) { return lhs.duration > rhs.duration; };
+			if (m_slowest_count > 0 && (m_slowest.size() < m_slowest_count || m_slowest.front().duration < record.duration))
+			{
+				record.breakdown.assign(m_current.begin(), m_current.end());
+				std::sort(record.breakdown.begin(), record.breakdown.end(), [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+				if (m_slowest.size() >= m_slowest_count)
+				{
+					std::pop_heap(m_slowest.begin(), m_slowest.end(), slower);
+					m_slowest.pop_back();
+				}
+				m_slowest.push_back(std::move(record));
+				std::push_heap(m_slowest.begin(), m_slowest.end(), slower);
+			}
+			m_current.clear();
+		}
+
+		std::vector<frame_record> ordered_frames() const
+		{
+			std::vector<frame_record> frames(m_frames.begin() + static_cast<std::ptrdiff_t>(m_oldest_frame), m_frames.end());
+			frames.insert(frames.end(), m_frames.begin(), m_frames.begin() + static_cast<std::ptrdiff_t>(m_oldest_frame));
+			return frames;
+		}
+
+		void write_histogram(std::ostream& stream) const
+		{
+			if (m_frames.empty())
+				return;
+			static constexpr size_t bucket_count = 10;
+			double min = m_frame_times.get_min();
+			double width = (m_frame_times.get_max() - min) / bucket_count;
+			size_t counts[bucket_count] = {};
+			for (const frame_record& frame : m_frames)
+			{
+				size_t bucket = width > 0.0 ? static_cast<size_t>((frame.duration - min) / width) : 0;
+				++counts[std::min(bucket, bucket_count - 1)];
+			}
+			size_t peak = *std::max_element(counts, counts + bucket_count);
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				stream << "  [" << min + width * i << ", " << min + width * (i + 1) << ") " << std::string(peak ? counts[i] * 40 / peak : 0, '#') << ' ' << counts[i] << "\n";
+				if (width <= 0.0)
+					break;
+			}
+		}
+
+		mutable std::mutex m_mutex;
+		bool m_enabled = false;
+		size_t m_slowest_count = 10;
+		unsigned long long m_frame_index = 0;
+		sch::time_point<clock_t> m_frame_start;
+		std::unordered_map<std::string, double> m_current;
+		size_t m_history_count = 1024;
+		size_t m_oldest_frame = 0;
+		std::vector<frame_record> m_frames;
+		std::vector<frame_record> m_slowest;
+		streaming_moments m_frame_times;
+		quantile_sketch m_frame_sketch;
+	};
+
+	class io_site
+	{
+	public:
+		explicit io_site(const char* name, size_t trace_threshold = 1 << 20) : m_name(name), m_trace_threshold(trace_threshold)
+		{
+			m_next = head().load(std::memory_order_relaxed);
+			while (!head().compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed));
+			detail::fork_registry::get().add(this,
+				[this]() { m_mutex.lock(); },
+				[this]() { m_mutex.unlock(); },
+				[this]() { m_mutex.unlock(); },
+				detail::fork_rank::statistics);
+		}
+
+		io_site(const io_site&) = delete;
+		io_site& operator=(const io_site&) = delete;
+
+		~io_site()
+		{
+			detail::fork_registry::get().remove(this);
+		}
+
+		void record(const char* operation, long long bytes, sch::time_point<clock_t> start, sch::time_point<clock_t> end)
+		{
+			long long latency = sch::duration_cast<sch::nanoseconds>(end - start).count();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_calls;
+				if (bytes < 0)
+					++m_errors;
+				else
+					m_bytes += static_cast<unsigned long long>(bytes);
+				m_busy_time += latency;
+				m_latency.add(static_cast<double>(latency));
+				m_latency_sketch.add(static_cast<double>(latency));
+			}
+
+			if (bytes >= 0 && static_cast<size_t>(bytes) >= m_trace_threshold && instrumentor::get().is_active())
+			{
+				long long trace_start = sch::time_point_cast<time_units::milliseconds::type>(start).time_since_epoch().count();
+				long long trace_end = sch::time_point_cast<time_units::milliseconds::type>(end).time_since_epoch().count();
+				size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				instrumentor::get().write_profile({ m_name, trace_start, trace_end, threadID, trace_args().add("op", operation).add("bytes", bytes).str(), -1, -1,
+					sch::duration_cast<sch::nanoseconds>(start.time_since_epoch()).count(), sch::duration_cast<sch::nanoseconds>(end.time_since_epoch()).count() });
+			}
+		}
+
+		const char* get_name() const noexcept
+		{
+			return m_name;
+		}
+
+		unsigned long long get_call_count() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_calls;
+		}
+
+		unsigned long long get_error_count() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_errors;
+		}
+
+		unsigned long long get_bytes() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_bytes;
+		}
+
+		double get_bandwidth() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_busy_time > 0 ? static_cast<double>(m_bytes) * 1e9 / static_cast<double>(m_busy_time) : 0.0;
+		}
+
+		double get_latency_percentile(double percentile) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return std::clamp(m_latency_sketch.quantile(percentile / 100.0), m_latency.get_min(), m_latency.get_max());
+		}
+
+		streaming_moments get_latency_statistics() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_latency;
+		}
+
+		template <class FunT>
+		static void for_each(FunT fun)
+		{
+			for (io_site* site = head().load(std::memory_order_acquire); site; site = site->m_next)
+				fun(*site);
+		}
+
+	private:
+		static std::atomic<io_site*>& head() noexcept
+		{
+			static std::atomic<io_site*> instance{ nullptr };
+			return instance;
+		}
+
+		const char* m_name;
+		size_t m_trace_threshold;
+		io_site* m_next = nullptr;
+
+		mutable std::mutex m_mutex;
+		unsigned long long m_calls = 0;
+		unsigned long long m_errors = 0;
+		unsigned long long m_bytes = 0;
+		long long m_busy_time = 0;
+		streaming_moments m_latency;
+		quantile_sketch m_latency_sketch;
+	};
+
+	namespace io
+	{
+#ifndef _WIN32
+		inline ssize_t read(io_site& site, int fd, void* buffer, size_t count)
+		{
+			auto start = clock_t::now();
+			ssize_t result = ::read(fd, buffer, count);
+			site.record("read", static_cast<long long>(result), start, clock_t::now());
+			return result;
+		}
+
+		inline ssize_t write(io_site& site, int fd, const void* buffer, size_t count)
+		{
+			auto start = clock_t::now();
+			ssize_t result = ::write(fd, buffer, count);
+			site.record("write", static_cast<long long>(result), start, clock_t::now());
+			return result;
+		}
+
+		inline ssize_t pread(io_site& site, int fd, void* buffer, size_t count, off_t offset)
+		{
+			auto start = clock_t::now();
+			ssize_t result = ::pread(fd, buffer, count, offset);
+			site.record("pread", static_cast<long long>(result), start, clock_t::now());
+			return result;
+		}
+
+		inline ssize_t pwrite(io_site& site, int fd, const void* buffer, size_t count, off_t offset)
+		{
+			auto start = clock_t::now();
+			ssize_t result = ::pwrite(fd, buffer, count, offset);
+			site.record("pwrite", static_cast<long long>(result), start, clock_t::now());
+			return result;
+		}
+#endif // _WIN32
+
+		inline std::istream& read(io_site& site, std::istream& stream, char* buffer, std::streamsize count)
+		{
+			auto start = clock_t::now();
+			stream.read(buffer, count);
+			long long transferred = static_cast<long long>(stream.gcount());
+			site.record("read", stream.bad() ? -1 : transferred, start, clock_t::now());
+			return stream;
+		}
+
+		inline std::ostream& write(io_site& site, std::ostream& stream, const char* buffer, std::streamsize count)
+		{
+			auto start = clock_t::now();
+			stream.write(buffer, count);
+			site.record("write", stream.good() ? static_cast<long long>(count) : -1, start, clock_t::now());
+			return stream;
+		}
+
+		inline std::ostream& flush(io_site& site, std::ostream& stream)
+		{
+			auto start = clock_t::now();
+			stream.flush();
+			site.record("flush", stream.good() ? 0 : -1, start, clock_t::now());
+			return stream;
+		}
+	}
+
+	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+	void report_io_stats(std::ostream& stream)
+	{
+		stream << "I/O Statistics:\n";
+		stream << "-------------------\n";
+		io_site::for_each([&](const io_site& site)
+			{
+				streaming_moments latency = site.get_latency_statistics();
+				stream << site.get_name() << ": " << site.get_call_count() << " calls, " << site.get_error_count() << " errors, "
+					<< site.get_bytes() << " bytes, " << site.get_bandwidth() / (1024.0 * 1024.0) << " MiB/s, latency average "
+					<< detail::duration_value_cast<time_units::nanoseconds, _Duration>(latency.get_mean()) << ", p50 "
+					<< detail::duration_value_cast<time_units::nanoseconds, _Duration>(site.get_latency_percentile(50.0)) << ", p99 "
+					<< detail::duration_value_cast<time_units::nanoseconds, _Duration>(site.get_latency_percentile(99.0)) << ", max "
+					<< detail::duration_value_cast<time_units::nanoseconds, _Duration>(latency.get_max()) << ' ' << _Duration::name << "\n";
+			});
+		stream << "-------------------\n";
+	}
+
+	struct scope_allocation_stats
+	{
+		std::string name;
+		unsigned long long allocations = 0;
+		unsigned long long frees = 0;
+		unsigned long long allocated_bytes = 0;
+		unsigned long long freed_bytes = 0;
+	};
+
+	namespace detail
+	{
+		struct allocation_header
+		{
+			size_t size;
+			unsigned long long scope;
+		};
+
+		static_assert(sizeof(allocation_header) == 16, "allocation header must keep the default new alignment");
+
+		static constexpr unsigned long long untracked_scope = ~0ULL;
+		static constexpr size_t allocation_batch_slots = 32;
+		static constexpr size_t allocation_batch_events = 256;
+
+		struct allocation_slot
+		{
+			unsigned long long scope;
+			char name[scope_name_capacity];
+			unsigned long long allocations;
+			unsigned long long frees;
+			unsigned long long allocated_bytes;
+			unsigned long long freed_bytes;
+		};
+
+		struct allocation_batch
+		{
+			allocation_slot slots[allocation_batch_slots];
+			size_t used;
+			size_t events;
+		};
+
+		inline std::atomic<bool>& allocation_tracing_enabled() noexcept
+		{
+			static std::atomic<bool> enabled{ false };
+			return enabled;
+		}
+
+		inline bool& allocation_in_hook() noexcept
+		{
+			static thread_local bool in_hook = false;
+			return in_hook;
+		}
+
+		inline allocation_batch& thread_allocation_batch() noexcept
+		{
+			static thread_local allocation_batch batch{};
+			return batch;
+		}
+	}
+
+	class allocation_tracer
+	{
+	public:
+		allocation_tracer()
+		{
+			detail::fork_registry::get().add(this,
+				[this]()
+				{
+					detail::allocation_in_hook() = true;
+					m_thread_mutex.lock();
+					m_mutex.lock();
+				},
+				[this]()
+				{
+					m_mutex.unlock();
+					m_thread_mutex.unlock();
+					detail::allocation_in_hook() = false;
+				},
+				[this]()
+				{
+					if (m_thread.joinable())
+						detail::abandon_thread(m_thread);
+					m_mutex.unlock();
+					m_thread_mutex.unlock();
+					detail::allocation_in_hook() = false;
+				},
+				detail::fork_rank::allocator,
+				[this]()
+				{
+					std::lock_guard<std::mutex> lock(m_thread_mutex);
+					if (m_running && !m_thread.joinable())
+						launch();
+				});
+		}
+
+		~allocation_tracer()
+		{
+			detail::fork_registry::get().remove(this);
+		}
+
+		void start(sch::milliseconds counter_interval = sch::milliseconds(10))
+		{
+			detail::resume_after_fork();
+			std::lock_guard<std::mutex> lock(m_thread_mutex);
+			if (detail::allocation_tracing_enabled())
+				return;
+			detail::scope_tracking_users().fetch_add(1, std::memory_order_relaxed);
+			detail::allocation_tracing_enabled() = true;
+			m_counter_interval = counter_interval;
+			m_running = true;
+			launch();
+		}
+
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_thread_mutex);
+				if (!detail::allocation_tracing_enabled())
+					return;
+				detail::allocation_tracing_enabled() = false;
+				m_running = false;
+			}
+			m_thread_cv.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
+			detail::scope_tracking_users().fetch_sub(1, std::memory_order_relaxed);
+			flush();
+		}
+
+		bool is_enabled() const noexcept
+		{
+			return detail::allocation_tracing_enabled().load(std::memory_order_relaxed);
+		}
+
+		void flush()
+		{
+			bool& in_hook = detail::allocation_in_hook();
+			bool previous = in_hook;
+			in_hook = true;
+			flush_batch(detail::thread_allocation_batch());
+			in_hook = previous;
+		}
+
+		long long get_live_bytes() const noexcept
+		{
+			return m_live_bytes.load(std::memory_order_relaxed);
+		}
+
+		std::vector<scope_allocation_stats> get_scope_statistics()
+		{
+			flush();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::vector<scope_allocation_stats> result;
+			for (const auto& scope : m_scopes)
+				result.push_back(scope.second);
+			std::sort(result.begin(), result.end(), [](const scope_allocation_stats& lhs, const scope_allocation_stats& rhs) { return lhs.allocated_bytes > rhs.allocated_bytes; });
+			return result;
+		}
+
+		void write_report(std::ostream& stream)
+		{
+			std::vector<scope_allocation_stats> scopes = get_scope_statistics();
+			stream << "Allocation Summary:\n";
+			stream << "-------------------\n";
+			stream << "Live Bytes: " << get_live_bytes() << " bytes\n";
+			for (const scope_allocation_stats& scope : scopes)
+			{
+				stream << scope.name << ": " << scope.allocations << " allocations, " << scope.frees << " frees, "
+					<< scope.allocated_bytes << " bytes allocated, " << scope.freed_bytes << " bytes freed, "
+					<< static_cast<long long>(scope.allocated_bytes - scope.freed_bytes) << " live bytes\n";
+			}
+			stream << "-------------------\n";
+		}
+
+		unsigned long long record_allocation(size_t size) noexcept
+		{
+			detail::allocation_batch& batch = detail::thread_allocation_batch();
+			static thread_local batch_guard guard;
+			(void)guard;
+
+			unsigned long long scope = 0;
+			const char* name = "<no scope>";
+			detail::scope_stack* stack = detail::published_scope_stack();
+			if (stack)
+			{
+				size_t depth = stack->depth.load(std::memory_order_relaxed);
+				if (depth > 0)
+				{
+					const detail::active_scope& entry = stack->entries[std::min<size_t>(depth, COCO_MAX_SCOPE_DEPTH) - 1];
+					scope = entry.id == 0 || entry.id == detail::untracked_scope ? 1 : entry.id;
+					name = entry.name;
+				}
+			}
+
+			detail::allocation_slot& slot = find_slot(batch, scope, name);
+			++slot.allocations;
+			slot.allocated_bytes += size;
+			if (++batch.events >= detail::allocation_batch_events)
+				flush_batch(batch);
+			return scope;
+		}
+
+		void record_free(unsigned long long scope, size_t size) noexcept
+		{
+			detail::allocation_batch& batch = detail::thread_allocation_batch();
+			detail::allocation_slot& slot = find_slot(batch, scope, nullptr);
+			++slot.frees;
+			slot.freed_bytes += size;
+			if (++batch.events >= detail::allocation_batch_events)
+				flush_batch(batch);
+		}
+
+		static allocation_tracer& get()
+		{
+			static allocation_tracer instance;
+			return instance;
+		}
+
+	private:
+		void launch()
+		{
+			m_thread = std::thread([this]()
+				{
+					std::unique_lock<std::mutex> lock(m_thread_mutex);
+					size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+					while (m_running)
+					{
+						m_thread_cv.wait_for(lock, m_counter_interval, [this]() { return !m_running; });
+						if (!m_running)
+							break;
+						lock.unlock();
+						long long live_bytes = get_live_bytes();
+						COCO_USDT_PROBE2(counter, static_cast<const char*>("heap"), live_bytes);
+						if (instrumentor::get().is_active())
+						{
+							long long ts = sch::time_point_cast<time_units::milliseconds::type>(clock_t::now()).time_since_epoch().count();
+							instrumentor::get().write_counter({ "heap", ts, ts, threadID, trace_args().add("live_bytes", live_bytes).str() });
+						}
+						lock.lock();
+					}
+				});
+		}
+
+		struct batch_guard
+		{
+			~batch_guard()
+			{
+				allocation_tracer::get().flush();
+			}
+		};
+
+		detail::allocation_slot& find_slot(detail::allocation_batch& batch, unsigned long long scope, const char* name) noexcept
+		{
+			for (size_t i = 0; i < batch.used; ++i)
+			{
+				detail::allocation_slot& slot = batch.slots[i];
+				if (slot.scope == scope)
+				{
+					if (name && slot.name[0] == '\0')
+						std::strncpy(slot.name, name, detail::scope_name_capacity - 1);
+					return slot;
+				}
+			}
+			if (batch.used == detail::allocation_batch_slots)
+				flush_batch(batch);
+
+			detail::allocation_slot& slot = batch.slots[batch.used++];
+			slot = detail::allocation_slot{};
+			slot.scope = scope;
+			if (name)
+				std::strncpy(slot.name, name, detail::scope_name_capacity - 1);
+			return slot;
+		}
+
+		void flush_batch(detail::allocation_batch& batch)
+		{
+			long long live_delta = 0;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				for (size_t i = 0; i < batch.used; ++i)
+				{
+					const detail::allocation_slot& slot = batch.slots[i];
+					scope_allocation_stats& stats = m_scopes[slot.scope];
+					if (stats.name.empty() && slot.name[0] != '\0')
+						stats.name = slot.name;
+					stats.allocations += slot.allocations;
+					stats.frees += slot.frees;
+					stats.allocated_bytes += slot.allocated_bytes;
+					stats.freed_bytes += slot.freed_bytes;
+					live_delta += static_cast<long long>(slot.allocated_bytes) - static_cast<long long>(slot.freed_bytes);
+				}
+			}
+			m_live_bytes.fetch_add(live_delta, std::memory_order_relaxed);
+			batch.used = 0;
+			batch.events = 0;
+		}
+
+		std::atomic<long long> m_live_bytes{ 0 };
+		std::mutex m_mutex;
+		std::unordered_map<unsigned long long, scope_allocation_stats> m_scopes;
+
+		std::mutex m_thread_mutex;
+		std::condition_variable m_thread_cv;
+		sch::milliseconds m_counter_interval{ 0 };
+		bool m_running = false;
+		std::thread m_thread;
+	};
+
+	namespace detail
+	{
+		inline void* traced_allocate(size_t size) noexcept
+		{
+			void* block = std::malloc(size + sizeof(allocation_header));
+			if (!block)
+				return nullptr;
+			allocation_header* header = static_cast<allocation_header*>(block);
+			header->size = size;
+			header->scope = untracked_scope;
+			bool& in_hook = allocation_in_hook();
+			if (!in_hook && allocation_tracing_enabled().load(std::memory_order_relaxed))
+			{
+				in_hook = true;
+				header->scope = allocation_tracer::get().record_allocation(size);
+				in_hook = false;
+			}
+			return header + 1;
+		}
+
+		inline void traced_free(void* pointer) noexcept
+		{
+			if (!pointer)
+				return;
+			allocation_header* header = static_cast<allocation_header*>(pointer) - 1;
+			bool& in_hook = allocation_in_hook();
+			if (header->scope != untracked_scope && !in_hook && allocation_tracing_enabled().load(std::memory_order_relaxed))
+			{
+				in_hook = true;
+				allocation_tracer::get().record_free(header->scope, header->size);
+				in_hook = false;
+			}
+			std::free(header);
+		}
+	}
+
+	namespace detail
+	{
+		static constexpr size_t allocator_latency_buckets = 32;
+
+		struct allocator_statistics
+		{
+			unsigned long long allocations = 0;
+			unsigned long long failures = 0;
+			unsigned long long resets = 0;
+			size_t high_water = 0;
+			unsigned long long latency_samples[allocator_latency_buckets] = {};
+			long long last_reset = 0;
+			long long reset_interval_sum = 0;
+
+			void record_latency(long long ns) noexcept
+			{
+				size_t bucket = 0;
+				while (ns > 1 && bucket + 1 < allocator_latency_buckets)
+				{
+					ns >>= 1;
+					++bucket;
+				}
+				++latency_samples[bucket];
+			}
+
+			long long latency_percentile(double percentile) const noexcept
+			{
+				unsigned long long total = 0;
+				for (unsigned long long count : latency_samples)
+					total += count;
+				if (total == 0)
+					return 0;
+				unsigned long long rank = static_cast<unsigned long long>(std::ceil(percentile / 100.0 * total));
+				unsigned long long seen = 0;
+				for (size_t i = 0; i < allocator_latency_buckets; ++i)
+				{
+					seen += latency_samples[i];
+					if (seen >= rank && latency_samples[i] != 0)
+						return 1LL << i;
+				}
+				return 1LL << (allocator_latency_buckets - 1);
+			}
+		};
+	}
+
+	class arena_allocator
+	{
+	public:
+		arena_allocator(const char* name, size_t capacity, size_t latency_sample_interval = 64) :
+			m_name(name), m_capacity(capacity), m_sample_interval(latency_sample_interval ? latency_sample_interval : 1)
+		{
+			m_buffer = static_cast<unsigned char*>(std::malloc(capacity));
+			COCO_ASSERT(m_buffer, "arena allocation failed");
+			m_stats.last_reset = clock_t::now().time_since_epoch().count();
+		}
+
+		~arena_allocator()
+		{
+			std::free(m_buffer);
+		}
+
+		arena_allocator(const arena_allocator&) = delete;
+		arena_allocator& operator=(const arena_allocator&) = delete;
+
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept
+		{
+			COCO_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "alignment must be a power of two");
+			if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+			{
+				++m_stats.failures;
+				return nullptr;
+			}
+			bool sampled = ++m_stats.allocations % m_sample_interval == 0;
+			sch::time_point<clock_t> start = sampled ? clock_t::now() : sch::time_point<clock_t>{};
+
+			uintptr_t base = reinterpret_cast<uintptr_t>(m_buffer);
+			uintptr_t aligned = (base + m_used + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+			size_t offset = static_cast<size_t>(aligned - base);
+			if (!m_buffer || offset + size > m_capacity)
+			{
+				++m_stats.failures;
+				return nullptr;
+			}
+			m_padding += offset - m_used;
+			m_total_padding += offset - m_used;
+			m_total_bytes += offset + size - m_used;
+			m_used = offset + size;
+			if (m_used > m_stats.high_water)
+				m_stats.high_water = m_used;
+
+			if (sampled)
+				m_stats.record_latency(sch::duration_cast<sch::nanoseconds>(clock_t::now() - start).count());
+			return m_buffer + offset;
+		}
+
+		template <class T, class... Args>
+		T* create(Args&&... args)
+		{
+			void* memory = allocate(sizeof(T), alignof(T));
+			return memory ? new (memory) T(std::forward<Args>(args)...) : nullptr;
+		}
+
+		void reset()
+		{
+			long long now = clock_t::now().time_since_epoch().count();
+			m_stats.reset_interval_sum += now - m_stats.last_reset;
+			m_stats.last_reset = now;
+			++m_stats.resets;
+			emit_counters();
+			m_used = 0;
+			m_padding = 0;
+		}
+
+		void emit_counters() const
 		{
-			return m_time;
+			COCO_USDT_PROBE2(counter, m_name, static_cast<long long>(m_used));
+			if (!instrumentor::get().is_active())
+				return;
+			long long ts = sch::time_point_cast<time_units::milliseconds::type>(clock_t::now()).time_since_epoch().count();
+			size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+			instrumentor::get().write_counter({ m_name, ts, ts, threadID, trace_args()
+				.add("used", static_cast<long long>(m_used))
+				.add("high_water", static_cast<long long>(m_stats.high_water))
+				.add("fragmentation", get_fragmentation())
+				.add("resets", static_cast<long long>(m_stats.resets)).str() });
 		}
 
-		template <_COCO_CONCEPT_DURATION_T _To _COCO_ENABLE_IF_DURATION_T(_To)>
-		long long get_casted_time() const
+		void write_report(std::ostream& stream) const
 		{
-			return duration_count_cast<time_units::milliseconds, _To>(m_time);
+			stream << m_name << ": " << m_stats.high_water << " / " << m_capacity << " bytes high water, "
+				<< m_stats.allocations << " allocations, " << m_stats.failures << " failures, "
+				<< m_stats.resets << " resets (" << get_reset_frequency() << " per second), "
+				<< get_total_fragmentation() * 100.0 << "% fragmentation, "
+				<< "p50 <= " << m_stats.latency_percentile(50.0) << " ns, p99 <= " << m_stats.latency_percentile(99.0) << " ns\n";
 		}
 
-	private:
-		sch::time_point<clock_t> now()
+		double get_fragmentation() const noexcept
 		{
-			return clock_t::now();
+			return m_used ? static_cast<double>(m_padding) / static_cast<double>(m_used) : 0.0;
 		}
 
-		constexpr sch::time_point<clock_t, typename time_units::milliseconds::type> tp_cast(const sch::time_point<clock_t>& tp)
+		double get_total_fragmentation() const noexcept
 		{
-			return sch::time_point_cast<typename time_units::milliseconds::type>(tp);
+			return m_total_bytes ? static_cast<double>(m_total_padding) / static_cast<double>(m_total_bytes) : 0.0;
 		}
 
-		sch::time_point<clock_t> m_timepoint;
-		std::string m_name;
-		long long m_time = 0;
-		bool m_stopped = false;
+		double get_reset_frequency() const noexcept
+		{
+			if (m_stats.resets == 0 || m_stats.reset_interval_sum == 0)
+				return 0.0;
+			double seconds = sch::duration_cast<sch::duration<double>>(clock_t::duration(m_stats.reset_interval_sum)).count();
+			return static_cast<double>(m_stats.resets) / seconds;
+		}
+
+		const char* get_name() const noexcept
+		{
+			return m_name;
+		}
+
+		size_t get_capacity() const noexcept
+		{
+			return m_capacity;
+		}
+
+		size_t get_used() const noexcept
+		{
+			return m_used;
+		}
+
+		size_t get_high_water() const noexcept
+		{
+			return m_stats.high_water;
+		}
+
+		const detail::allocator_statistics& get_statistics() const noexcept
+		{
+			return m_stats;
+		}
+
+	private:
+		const char* m_name;
+		unsigned char* m_buffer = nullptr;
+		size_t m_capacity;
+		size_t m_used = 0;
+		size_t m_padding = 0;
+		unsigned long long m_total_padding = 0;
+		unsigned long long m_total_bytes = 0;
+		size_t m_sample_interval;
+		detail::allocator_statistics m_stats;
 	};
 
-	class timer_statistics
+	class pool_allocator
 	{
 	public:
-		void add_measurement(long long time)
+		pool_allocator(const char* name, size_t block_size, size_t block_count, size_t latency_sample_interval = 64) :
+			m_name(name), m_block_count(block_count), m_sample_interval(latency_sample_interval ? latency_sample_interval : 1)
 		{
-			m_measurements.push_back(time);
+			m_block_size = (std::max(block_size, sizeof(void*)) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+			if (block_count <= std::numeric_limits<size_t>::max() / m_block_size)
+				m_buffer = static_cast<unsigned char*>(std::malloc(m_block_size * block_count));
+			COCO_ASSERT(m_buffer, "pool allocation failed");
+			m_stats.last_reset = clock_t::now().time_since_epoch().count();
+			reset_free_list();
 		}
 
-		void clear_measurements()
+		~pool_allocator()
 		{
-			m_measurements.clear();
+			std::free(m_buffer);
 		}
 
-		double calculate_average() const
+		pool_allocator(const pool_allocator&) = delete;
+		pool_allocator& operator=(const pool_allocator&) = delete;
+
+		void* allocate(size_t size) noexcept
 		{
-			if (m_measurements.empty())
+			bool sampled = ++m_stats.allocations % m_sample_interval == 0;
+			sch::time_point<clock_t> start = sampled ? clock_t::now() : sch::time_point<clock_t>{};
+
+			if (!m_free || size > m_block_size)
 			{
-				COCO_ASSERT(false, "no measurements found");
+				++m_stats.failures;
+				return nullptr;
+			}
+			void* block = m_free;
+			m_free = *static_cast<void**>(block);
+			m_requested += size;
+			if (++m_in_use > m_stats.high_water)
+				m_stats.high_water = m_in_use;
+
+			if (sampled)
+				m_stats.record_latency(sch::duration_cast<sch::nanoseconds>(clock_t::now() - start).count());
+			return block;
+		}
+
+		void deallocate(void* block, size_t size) noexcept
+		{
+			if (!block)
+				return;
+			COCO_ASSERT(block >= m_buffer && block < m_buffer + m_block_size * m_block_count, "block does not belong to this pool");
+			*static_cast<void**>(block) = m_free;
+			m_free = block;
+			m_requested -= size;
+			--m_in_use;
+		}
+
+		void reset()
+		{
+			long long now = clock_t::now().time_since_epoch().count();
+			m_stats.reset_interval_sum += now - m_stats.last_reset;
+			m_stats.last_reset = now;
+			++m_stats.resets;
+			emit_counters();
+			reset_free_list();
+		}
+
+		void emit_counters() const
+		{
+			COCO_USDT_PROBE2(counter, m_name, static_cast<long long>(m_in_use));
+			if (!instrumentor::get().is_active())
+				return;
+			long long ts = sch::time_point_cast<time_units::milliseconds::type>(clock_t::now()).time_since_epoch().count();
+			size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+			instrumentor::get().write_counter({ m_name, ts, ts, threadID, trace_args()
+				.add("in_use", static_cast<long long>(m_in_use))
+				.add("high_water", static_cast<long long>(m_stats.high_water))
+				.add("fragmentation", get_fragmentation())
+				.add("resets", static_cast<long long>(m_stats.resets)).str() });
+		}
+
+		void write_report(std::ostream& stream) const
+		{
+			stream << m_name << ": " << m_stats.high_water << " / " << m_block_count << " blocks high water, "
+				<< m_stats.allocations << " allocations, " << m_stats.failures << " failures, "
+				<< m_stats.resets << " resets, "
+				<< get_fragmentation() * 100.0 << "% fragmentation, "
+				<< "p50 <= " << m_stats.latency_percentile(50.0) << " ns, p99 <= " << m_stats.latency_percentile(99.0) << " ns\n";
+		}
+
+		double get_fragmentation() const noexcept
+		{
+			if (m_in_use == 0)
 				return 0.0;
+			return 1.0 - static_cast<double>(m_requested) / static_cast<double>(m_in_use * m_block_size);
+		}
+
+		const char* get_name() const noexcept
+		{
+			return m_name;
+		}
+
+		size_t get_block_size() const noexcept
+		{
+			return m_block_size;
+		}
+
+		size_t get_in_use() const noexcept
+		{
+			return m_in_use;
+		}
+
+		size_t get_high_water() const noexcept
+		{
+			return m_stats.high_water;
+		}
+
+		const detail::allocator_statistics& get_statistics() const noexcept
+		{
+			return m_stats;
+		}
+
+	private:
+		void reset_free_list() noexcept
+		{
+			m_free = nullptr;
+			m_in_use = 0;
+			m_requested = 0;
+			if (!m_buffer)
+				return;
+			for (size_t i = m_block_count; i > 0; --i)
+			{
+				void* block = m_buffer + (i - 1) * m_block_size;
+				*static_cast<void**>(block) = m_free;
+				m_free = block;
 			}
-			long long sum = std::accumulate(m_measurements.begin(), m_measurements.end(), 0LL);
-			return static_cast<double>(sum) / m_measurements.size();
 		}
 
-		double calculate_variance() const
+		const char* m_name;
+		unsigned char* m_buffer = nullptr;
+		size_t m_block_size;
+		size_t m_block_count;
+		void* m_free = nullptr;
+		size_t m_in_use = 0;
+		size_t m_requested = 0;
+		size_t m_sample_interval;
+		detail::allocator_statistics m_stats;
+	};
+
+	namespace detail
+	{
+		template <class T>
+		class bounded_queue
 		{
-			if (m_measurements.empty())
+		public:
+			explicit bounded_queue(size_t capacity)
 			{
-				COCO_ASSERT(false, "no measurements found");
-				return 0.0;
+				size_t size = 2;
+				while (size < capacity)
+					size <<= 1;
+				m_cells = std::vector<cell>(size);
+				m_mask = size - 1;
+				for (size_t i = 0; i < size; ++i)
+					m_cells[i].sequence.store(i, std::memory_order_relaxed);
 			}
-			double avg = calculate_average();
-			double variance = 0.0;
-			for (long long time : m_measurements)
-				variance += std::pow(time - avg, 2);
-			variance /= m_measurements.size();
-			return variance;
+
+			bool try_push(const T& value) noexcept
+			{
+				size_t position = m_tail.load(std::memory_order_relaxed);
+				cell* target;
+				for (;;)
+				{
+					target = &m_cells[position & m_mask];
+					size_t sequence = target->sequence.load(std::memory_order_acquire);
+					auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+					if (diff == 0)
+					{
+						if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (diff < 0)
+					{
+						return false;
+					}
+					else
+					{
+						position = m_tail.load(std::memory_order_relaxed);
+					}
+				}
+				target->value = value;
+				target->sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+
+			bool try_pop(T& value) noexcept
+			{
+				cell& target = m_cells[m_head & m_mask];
+				size_t sequence = target.sequence.load(std::memory_order_acquire);
+				if (static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(m_head + 1) < 0)
+					return false;
+				value = target.value;
+				target.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+				++m_head;
+				return true;
+			}
+
+		private:
+			struct cell
+			{
+				std::atomic<size_t> sequence;
+				T value;
+			};
+
+			std::vector<cell> m_cells;
+			size_t m_mask = 0;
+			alignas(64) std::atomic<size_t> m_tail{ 0 };
+			alignas(64) size_t m_head = 0;
+		};
+	}
+
+#ifdef COCO_NETWORK
+	namespace detail
+	{
+#ifdef _WIN32
+		using socket_t = SOCKET;
+		static constexpr socket_t invalid_socket = INVALID_SOCKET;
+
+		inline bool network_startup()
+		{
+			static bool started = []()
+				{
+					WSADATA data;
+					return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+				}();
+			return started;
 		}
 
-		double calculate_standard_deviation() const
+		inline void close_socket(socket_t socket)
 		{
-			return std::sqrt(calculate_variance());
+			closesocket(socket);
 		}
+#else // _WIN32
+		using socket_t = int;
+		static constexpr socket_t invalid_socket = -1;
 
-		double calculate_median() const
+		inline bool network_startup()
 		{
-			if (m_measurements.empty())
+			return true;
+		}
+
+		inline void close_socket(socket_t socket)
+		{
+			::close(socket);
+		}
+#endif // _WIN32
+
+#ifdef MSG_NOSIGNAL
+		static constexpr int send_flags = MSG_NOSIGNAL;
+#else // MSG_NOSIGNAL
+		static constexpr int send_flags = 0;
+#endif // MSG_NOSIGNAL
+
+		inline bool wait_readable(socket_t socket, long timeout_ms)
+		{
+			fd_set read_set;
+			FD_ZERO(&read_set);
+			FD_SET(socket, &read_set);
+			timeval timeout{ timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+			return select(static_cast<int>(socket) + 1, &read_set, nullptr, nullptr, &timeout) > 0;
+		}
+
+		inline bool send_all(socket_t socket, const char* data, size_t size)
+		{
+			while (size > 0)
 			{
-				COCO_ASSERT(false, "no measurements found");
-				return 0.0;
+				auto sent = send(socket, data, static_cast<int>(size), send_flags);
+				if (sent <= 0)
+					return false;
+				data += sent;
+				size -= static_cast<size_t>(sent);
 			}
-			std::vector<long long> sorted_measurements = m_measurements;
-			std::sort(sorted_measurements.begin(), sorted_measurements.end());
-			size_t n = sorted_measurements.size();
-			if (n % 2 == 0)
-				return static_cast<double>(sorted_measurements[n / 2 - 1] + sorted_measurements[n / 2]) / 2.0;
-			else
-				return static_cast<double>(sorted_measurements[n / 2]);
+			return true;
 		}
+	}
+#endif // COCO_NETWORK
 
-		long long get_min_value() const
+	class prometheus_exporter
+	{
+	public:
+		prometheus_exporter()
 		{
-			if (m_measurements.empty())
+			detail::fork_registry::get().add(this,
+				[this]() { m_thread_mutex.lock(); },
+				[this]() { m_thread_mutex.unlock(); },
+				[this]()
+				{
+					m_running = false;
+					detail::abandon_thread(m_textfile_thread);
+#ifdef COCO_NETWORK
+					detail::abandon_thread(m_http_thread);
+#endif // COCO_NETWORK
+					m_thread_mutex.unlock();
+				});
+		}
+
+		prometheus_exporter(const prometheus_exporter&) = delete;
+		prometheus_exporter& operator=(const prometheus_exporter&) = delete;
+
+		~prometheus_exporter()
+		{
+			detail::fork_registry::get().remove(this);
+			stop();
+		}
+
+		void lock()
+		{
+			m_mutex.lock();
+		}
+
+		void unlock()
+		{
+			m_mutex.unlock();
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_summary(const std::string& name, const timer_statistics& stats, const std::string& help = "", std::vector<double> quantiles = { 0.5, 0.9, 0.99 })
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string metric = sanitize_name(name);
+			m_sources.push_back([this, metric, help, &stats, quantiles = std::move(quantiles)](std::string& out)
+				{
+					write_meta(out, metric, help, "summary");
+					write_summary(out, metric, std::string{}, stats, quantiles, &detail::to_seconds<_Duration>);
+				});
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_summary(const std::string& name, const timer_data_logger& logger, const std::string& help = "", std::vector<double> quantiles = { 0.5, 0.9, 0.99 })
+		{
+			add_summary<_Duration>(name, *logger.get_statistics(), help, std::move(quantiles));
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_histogram(const std::string& name, const timer_statistics& stats, std::vector<double> buckets, const std::string& help = "")
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string metric = sanitize_name(name);
+			std::sort(buckets.begin(), buckets.end());
+			m_sources.push_back([this, metric, help, &stats, buckets = std::move(buckets)](std::string& out)
+				{
+					write_meta(out, metric, help, "histogram");
+					write_histogram(out, metric, std::string{}, stats, buckets, &detail::to_seconds<_Duration>);
+				});
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_timer(const std::string& name, const timer<_Duration>& timer, const std::string& help = "")
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string metric = sanitize_name(name);
+			m_sources.push_back([metric, help, &timer](std::string& out)
+				{
+					write_meta(out, metric, help, "gauge");
+					write_sample(out, metric, nullptr, detail::to_seconds<_Duration>(static_cast<double>(timer.get_time())));
+				});
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_manager(const std::string& name, const multiple_timer_manager<_Duration>& manager, const std::string& help = "", std::vector<double> quantiles = { 0.5, 0.9, 0.99 })
+		{
+			add_summary<_Duration>(name, manager.get_data_logger(), help, std::move(quantiles));
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string metric = sanitize_name(name) + "_elapsed";
+			m_sources.push_back([metric, &manager](std::string& out)
+				{
+					write_meta(out, metric, "", "gauge");
+					manager.for_each_timer([&](const std::string& timer_name, const timer<_Duration>& timer)
+						{
+							out.append(metric).append("{timer=\"");
+							append_label_value(out, timer_name);
+							out.append("\"} ");
+							append_value(out, detail::to_seconds<_Duration>(static_cast<double>(timer.get_time())));
+							out.push_back('\n');
+						});
+				});
+		}
+
+		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
+		void add_family(const labeled_timer_family<_Duration>& family, const std::string& help = "", std::vector<double> quantiles = { 0.5, 0.9, 0.99 })
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string metric = sanitize_name(family.get_name());
+			m_sources.push_back([this, metric, help, &family, quantiles = std::move(quantiles)](std::string& out)
+				{
+					write_meta(out, metric, help, "summary");
+					size_t count = family.get_series_count();
+					for (size_t handle = 0; handle < count; ++handle)
+						write_summary(out, metric, family_labels(family, handle), family.get_statistics(handle), quantiles, &detail::to_seconds<_Duration>);
+				});
+		}
+
+		void add_meter(const std::string& name, const rate_meter& meter, const std::string& help = "")
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string metric = sanitize_name(name);
+			std::string total = metric + "_total";
+			std::string rate = metric + "_rate";
+			m_sources.push_back([total, rate, help, &meter](std::string& out)
+				{
+					write_meta(out, total, help, "counter");
+					write_sample(out, total, nullptr, static_cast<double>(meter.get_count()));
+					write_meta(out, rate, help, "gauge");
+					write_rate(out, rate, "instant", meter.get_instant_rate());
+					write_rate(out, rate, "1s", meter.get_rate_1s());
+					write_rate(out, rate, "10s", meter.get_rate_10s());
+					write_rate(out, rate, "60s", meter.get_rate_60s());
+				});
+		}
+
+		void render(std::string& out)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			out.clear();
+			for (auto& source : m_sources)
+				source(out);
+		}
+
+		const std::string& render()
+		{
+			render(m_buffer);
+			return m_buffer;
+		}
+
+		bool write_textfile(const std::filesystem::path& filepath)
+		{
+			std::filesystem::path temp_path = filepath;
+			temp_path += ".tmp";
+			return write_textfile(filepath, temp_path, m_buffer);
+		}
+
+		void start_textfile_writer(const std::filesystem::path& filepath, sch::milliseconds interval = sch::seconds(15))
+		{
+			if (m_textfile_thread.joinable())
 			{
-				COCO_ASSERT(false, "no measurements found");
-				return 0;
+				COCO_ASSERT(false, "textfile writer is already running");
+				return;
 			}
-			return *std::min_element(m_measurements.begin(), m_measurements.end());
+			m_running = true;
+			m_textfile_thread = std::thread([this, filepath, interval]()
+				{
+					std::filesystem::path temp_path = filepath;
+					temp_path += ".tmp";
+					std::string buffer;
+					std::unique_lock<std::mutex> lock(m_thread_mutex);
+					while (m_running)
+					{
+						lock.unlock();
+						write_textfile(filepath, temp_path, buffer);
+						lock.lock();
+						m_thread_cv.wait_for(lock, interval, [this]() { return !m_running; });
+					}
+				});
 		}
 
-		long long get_max_value() const
+#ifdef COCO_NETWORK
+		bool start_http_server(unsigned short port, const char* address = "127.0.0.1")
 		{
-			if (m_measurements.empty())
+			if (m_http_thread.joinable() || !detail::network_startup())
 			{
-				COCO_ASSERT(false, "no measurements found");
-				return 0;
+				COCO_ASSERT(false, "http server is already running or network is unavailable");
+				return false;
+			}
+
+			detail::socket_t listener = socket(AF_INET, SOCK_STREAM, 0);
+			if (listener == detail::invalid_socket)
+				return false;
+
+			int reuse = 1;
+			setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+			sockaddr_in endpoint{};
+			endpoint.sin_family = AF_INET;
+			endpoint.sin_port = htons(port);
+			inet_pton(AF_INET, address, &endpoint.sin_addr);
+			socklen_t length = sizeof(endpoint);
+			if (bind(listener, reinterpret_cast<sockaddr*>(&endpoint), sizeof(endpoint)) != 0 || listen(listener, 8) != 0 ||
+				getsockname(listener, reinterpret_cast<sockaddr*>(&endpoint), &length) != 0)
+			{
+				detail::close_socket(listener);
+				return false;
+			}
+
+			m_http_port = ntohs(endpoint.sin_port);
+			m_running = true;
+			m_http_thread = std::thread([this, listener]()
+				{
+					std::string body;
+					char request[2048];
+					while (m_running)
+					{
+						if (!detail::wait_readable(listener, 100))
+							continue;
+						detail::socket_t client = accept(listener, nullptr, nullptr);
+						if (client == detail::invalid_socket)
+							continue;
+						serve_client(client, request, sizeof(request), body);
+						detail::close_socket(client);
+					}
+					detail::close_socket(listener);
+				});
+			return true;
+		}
+
+		unsigned short get_http_port() const noexcept
+		{
+			return m_http_port;
+		}
+#endif // COCO_NETWORK
+
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_thread_mutex);
+				m_running = false;
+			}
+			m_thread_cv.notify_all();
+			if (m_textfile_thread.joinable())
+				m_textfile_thread.join();
+#ifdef COCO_NETWORK
+			if (m_http_thread.joinable())
+				m_http_thread.join();
+#endif // COCO_NETWORK
+		}
+
+	private:
+		static std::string sanitize_name(const std::string& name)
+		{
+			std::string result = name;
+			for (size_t i = 0; i < result.size(); ++i)
+			{
+				char c = result[i];
+				bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+				if (!valid)
+					result[i] = '_';
+			}
+			if (result.empty())
+				result = "_";
+			return result;
+		}
+
+		static void append_label_value(std::string& out, const std::string& value)
+		{
+			for (char c : value)
+			{
+				if (c == '\\' || c == '"')
+				{
+					out.push_back('\\');
+					out.push_back(c);
+				}
+				else if (c == '\n')
+				{
+					out.append("\\n");
+				}
+				else
+				{
+					out.push_back(c);
+				}
+			}
+		}
+
+		static void append_value(std::string& out, double value)
+		{
+			if (std::isnan(value))
+				out.append("NaN");
+			else if (std::isinf(value))
+				out.append(value > 0 ? "+Inf" : "-Inf");
+			else
+				detail::append_double(out, value);
+		}
+
+		static void write_meta(std::string& out, const std::string& metric, const std::string& help, const char* type)
+		{
+			if (!help.empty())
+			{
+				out.append("# HELP ").append(metric).push_back(' ');
+				for (char c : help)
+				{
+					if (c == '\\')
+						out.append("\\\\");
+					else if (c == '\n')
+						out.append("\\n");
+					else
+						out.push_back(c);
+				}
+				out.push_back('\n');
 			}
-			return *std::max_element(m_measurements.begin(), m_measurements.end());
+			out.append("# TYPE ").append(metric).push_back(' ');
+			out.append(type).push_back('\n');
 		}
 
-		size_t get_measurement_count() const
+		static void write_sample(std::string& out, const std::string& metric, const char* suffix, const std::string& labels, double value)
 		{
-			return m_measurements.size();
+			out.append(metric);
+			if (suffix)
+				out.append(suffix);
+			if (!labels.empty())
+				out.append("{").append(labels).push_back('}');
+			out.push_back(' ');
+			append_value(out, value);
+			out.push_back('\n');
 		}
 
-	private:
-		std::vector<long long> m_measurements;
-	};
-
-	class timer_data_logger
-	{
-	public:
-		timer_data_logger() : m_stats(new timer_statistics()) {}
-
-		timer_data_logger(const timer_statistics& stats) : m_stats(new timer_statistics(stats)) {}
-
-		timer_data_logger(timer_statistics&& stats) noexcept : m_stats(new timer_statistics(std::move(stats))) {}
+		static void write_sample(std::string& out, const std::string& metric, const char* suffix, double value)
+		{
+			write_sample(out, metric, suffix, std::string{}, value);
+		}
 
-		~timer_data_logger()
+		const std::vector<long long>& sorted_copy(const timer_statistics& stats)
 		{
-			delete m_stats;
+			m_scratch = stats.copy_measurements();
+			std::sort(m_scratch.begin(), m_scratch.end());
+			return m_scratch;
 		}
 
-		timer_statistics* get_statistics() const
+		void write_summary(std::string& out, const std::string& metric, const std::string& labels, const timer_statistics& stats, const std::vector<double>& quantiles, double (*to_seconds)(double))
 		{
-			return m_stats;
+			const std::vector<long long>& sorted = sorted_copy(stats);
+			for (double quantile : quantiles)
+			{
+				out.append(metric).push_back('{');
+				if (!labels.empty())
+					out.append(labels).push_back(',');
+				out.append("quantile=\"");
+				detail::append_double(out, quantile);
+				out.append("\"} ");
+				append_value(out, sorted.empty() ? std::nan("") : to_seconds(static_cast<double>(detail::nearest_rank(sorted, quantile))));
+				out.push_back('\n');
+			}
+			long long sum = std::accumulate(sorted.begin(), sorted.end(), 0LL);
+			write_sample(out, metric, "_sum", labels, to_seconds(static_cast<double>(sum)));
+			write_sample(out, metric, "_count", labels, static_cast<double>(sorted.size()));
 		}
 
-		timer_data_logger& operator=(const timer_data_logger& other)
+		void write_histogram(std::string& out, const std::string& metric, const std::string& labels, const timer_statistics& stats, const std::vector<double>& buckets, double (*to_seconds)(double))
 		{
-			if (this != &other)
+			const std::vector<long long>& sorted = sorted_copy(stats);
+			auto it = sorted.begin();
+			for (double bound : buckets)
 			{
-				delete m_stats;
-				m_stats = new timer_statistics(*other.m_stats);
+				it = std::find_if(it, sorted.end(), [&](long long value) { return to_seconds(static_cast<double>(value)) > bound; });
+				write_bucket(out, metric, labels, bound, static_cast<long long>(it - sorted.begin()));
 			}
-			return *this;
+			write_bucket(out, metric, labels, std::numeric_limits<double>::infinity(), static_cast<long long>(sorted.size()));
+			long long sum = std::accumulate(sorted.begin(), sorted.end(), 0LL);
+			write_sample(out, metric, "_sum", labels, to_seconds(static_cast<double>(sum)));
+			write_sample(out, metric, "_count", labels, static_cast<double>(sorted.size()));
 		}
 
-		timer_data_logger& operator=(timer_data_logger&& other) noexcept
+		static void write_rate(std::string& out, const std::string& metric, const char* window, double value)
 		{
-			if (this != &other)
+			out.append(metric).append("{window=\"").append(window).append("\"} ");
+			append_value(out, value);
+			out.push_back('\n');
+		}
+
+		static void write_bucket(std::string& out, const std::string& metric, const std::string& labels, double bound, long long count)
+		{
+			out.append(metric).append("_bucket{");
+			if (!labels.empty())
+				out.append(labels).push_back(',');
+			out.append("le=\"");
+			append_value(out, bound);
+			out.append("\"} ");
+			detail::append_integer(out, count);
+			out.push_back('\n');
+		}
+
+		template <class _Family>
+		const std::string& family_labels(const _Family& family, size_t handle)
+		{
+			m_labels.clear();
+			const std::vector<std::string>& names = family.get_label_names();
+			const std::vector<std::string>& values = family.get_label_values(handle);
+			for (size_t i = 0; i < names.size() && i < values.size(); ++i)
 			{
-				delete m_stats;
-				m_stats = other.m_stats;
-				other.m_stats = nullptr;
+				if (i > 0)
+					m_labels.push_back(',');
+				m_labels.append(names[i]).append("=\"");
+				append_label_value(m_labels, values[i]);
+				m_labels.push_back('"');
 			}
-			return *this;
+			return m_labels;
 		}
 
-		void add_measurement(long long time)
+		bool write_textfile(const std::filesystem::path& filepath, const std::filesystem::path& temp_path, std::string& buffer)
 		{
-			m_stats->add_measurement(time);
+			render(buffer);
+			{
+				std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+				if (!file.is_open())
+				{
+					COCO_ASSERT(false, "Failed to open file for writing.");
+					return false;
+				}
+				file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			}
+			std::error_code error;
+			std::filesystem::rename(temp_path, filepath, error);
+			return !error;
 		}
 
-		template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
-		void log_statistics(const std::filesystem::path& filepath)
+#ifdef COCO_NETWORK
+		void serve_client(detail::socket_t client, char* request, size_t capacity, std::string& body)
 		{
-			std::ofstream file(filepath);
-			if (file.is_open())
+			size_t received = 0;
+			while (received < capacity - 1 && detail::wait_readable(client, 1000))
 			{
-				file << "Statistics Summary:\n";
-				file << "-------------------\n";
-				file << "Number of attempts: " << m_stats->get_measurement_count() << " times\n";
-				file << "Average Time: " << m_stats->calculate_average() << ' ' << _Duration::name << "\n";
-				file << "Variance: " << m_stats->calculate_variance() << ' ' << _Duration::name << "\n";
-				file << "Standard Deviation: " << m_stats->calculate_standard_deviation() << ' ' << _Duration::name << "\n";
-				file << "Median Time: " << m_stats->calculate_median() << ' ' << _Duration::name << "\n";
-				file << "Minimum Time: " << m_stats->get_min_value() << ' ' << _Duration::name << "\n";
-				file << "Maximum Time: " << m_stats->get_max_value() << ' ' << _Duration::name << "\n";
-				file << "-------------------\n";
-				file.close();
+				auto count = recv(client, request + received, static_cast<int>(capacity - 1 - received), 0);
+				if (count <= 0)
+					break;
+				received += static_cast<size_t>(count);
+				request[received] = '\0';
+				if (std::strstr(request, "\r\n\r\n"))
+					break;
 			}
-			else
+			request[received] = '\0';
+
+			bool found = std::strncmp(request, "GET /metrics ", 13) == 0 || std::strncmp(request, "GET / ", 6) == 0;
+			if (!found)
 			{
-				COCO_ASSERT(false, "Failed to open file for writing.");
+				static constexpr char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+				detail::send_all(client, not_found, sizeof(not_found) - 1);
+				return;
 			}
+
+			render(body);
+			char header[160] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\nContent-Length: ";
+			char* end = header + std::strlen(header);
+			end = std::to_chars(end, header + sizeof(header) - 4, body.size()).ptr;
+			std::memcpy(end, "\r\n\r\n", 4);
+			if (detail::send_all(client, header, static_cast<size_t>(end + 4 - header)))
+				detail::send_all(client, body.data(), body.size());
 		}
+#endif // COCO_NETWORK
 
-	private:
-		timer_statistics* m_stats;
+		std::mutex m_mutex;
+		std::vector<std::function<void(std::string&)>> m_sources;
+		std::vector<long long> m_scratch;
+		std::string m_labels;
+		std::string m_buffer;
+
+		std::mutex m_thread_mutex;
+		std::condition_variable m_thread_cv;
+		std::atomic<bool> m_running{ false };
+		std::thread m_textfile_thread;
+#ifdef COCO_NETWORK
+		std::thread m_http_thread;
+		unsigned short m_http_port = 0;
+#endif // COCO_NETWORK
 	};
 
+#ifdef COCO_NETWORK
 	template <_COCO_CONCEPT_DURATION_T _Duration = coco::time_units::microseconds _COCO_ENABLE_IF_DURATION_T(_Duration)>
-	class multiple_timer_manager
+	class statsd_exporter
 	{
 	public:
-		multiple_timer_manager() {}
-
-		~multiple_timer_manager()
+		statsd_exporter(const std::string& host, unsigned short port, sch::milliseconds flush_interval = sch::seconds(10), size_t max_packet_size = 1432, size_t queue_capacity = 65536)
+			: m_host(host), m_port(port), m_flush_interval(flush_interval), m_max_packet_size(max_packet_size), m_queue(queue_capacity)
 		{
-			for (auto& timer : m_timers)
-				delete timer.second;
+			detail::fork_registry::get().add(this,
+				[this]()
+				{
+					m_thread_mutex.lock();
+					m_metrics_mutex.lock();
+				},
+				[this]()
+				{
+					m_metrics_mutex.unlock();
+					m_thread_mutex.unlock();
+				},
+				[this]()
+				{
+					m_restart = m_thread.joinable();
+					detail::abandon_thread(m_thread);
+					m_running = false;
+					sample discarded;
+					while (m_queue.try_pop(discarded))
+						;
+					for (metric_state& metric : m_metrics)
+						metric = metric_state{ metric.name, {}, 0 };
+					m_metrics_mutex.unlock();
+					m_thread_mutex.unlock();
+				},
+				detail::fork_rank::component,
+				[this]()
+				{
+					if (m_restart)
+					{
+						m_restart = false;
+						start();
+					}
+				});
 		}
 
-		void add_and_start_timer(const std::string& timer_name)
+		statsd_exporter(const statsd_exporter&) = delete;
+		statsd_exporter& operator=(const statsd_exporter&) = delete;
+
+		~statsd_exporter()
 		{
-			if (m_timers.find(timer_name) == m_timers.end())
-				m_timers[timer_name] = new coco::timer<_Duration>();
-			COCO_ASSERT(false, "Timer already exists!");
+			detail::fork_registry::get().remove(this);
+			stop();
+			if (m_socket != detail::invalid_socket)
+				detail::close_socket(m_socket);
 		}
 
-		void stop_timer(const std::string& timer_name)
+		size_t register_metric(const std::string& name)
 		{
-			if (m_timers.find(timer_name) != m_timers.end())
+			detail::resume_after_fork();
+			std::lock_guard<std::mutex> lock(m_metrics_mutex);
+			for (size_t i = 0; i < m_metrics.size(); ++i)
 			{
-				m_timers[timer_name]->stop();
-				m_data_logger.add_measurement(m_timers[timer_name]->get_time());
+				if (m_metrics[i].name == name)
+					return i;
 			}
-			COCO_ASSERT(false, "Timer not found!");
+			m_metrics.push_back(metric_state{ name, {}, 0 });
+			return m_metrics.size() - 1;
 		}
 
-		void reset_timer(const std::string& timer_name)
+		bool record(size_t metric_id, long long value) noexcept
 		{
-			if (m_timers.find(timer_name) != m_timers.end())
-				m_timers[timer_name]->reset();
-			COCO_ASSERT(false, "Timer not found!");
+			if (m_queue.try_push(sample{ metric_id, value }))
+				return true;
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
 		}
 
-		void pause_timer(const std::string& timer_name)
+		bool record(size_t metric_id, const timer<_Duration>& timer) noexcept
 		{
-			if (m_timers.find(timer_name) != m_timers.end())
-				m_timers[timer_name]->pause();
-			COCO_ASSERT(false, "Timer not found!");
+			return record(metric_id, timer.get_time());
 		}
 
-		void resume_timer(const std::string& timer_name)
+		bool start()
 		{
-			if (m_timers.find(timer_name) != m_timers.end())
-				m_timers[timer_name]->resume();
-			COCO_ASSERT(false, "Timer not found!");
+			detail::resume_after_fork();
+			if (m_thread.joinable())
+			{
+				COCO_ASSERT(false, "statsd exporter is already running");
+				return false;
+			}
+			if (!open_socket())
+				return false;
+			m_running = true;
+			m_thread = std::thread([this]()
+				{
+					auto next_flush = clock_t::now() + m_flush_interval;
+					std::unique_lock<std::mutex> lock(m_thread_mutex);
+					while (m_running)
+					{
+						m_thread_cv.wait_for(lock, std::min<sch::milliseconds>(m_flush_interval, sch::milliseconds(10)), [this]() { return !m_running; });
+						lock.unlock();
+						drain();
+						if (clock_t::now() >= next_flush)
+						{
+							send_aggregates();
+							next_flush += m_flush_interval;
+						}
+						lock.lock();
+					}
+					lock.unlock();
+					drain();
+					send_aggregates();
+				});
+			return true;
 		}
 
-		void remove_timer(const std::string& timer_name)
+		void stop()
 		{
-			auto it = m_timers.find(timer_name);
-			if (it != m_timers.end())
-				m_timers.erase(it);
-			COCO_ASSERT(false, "Timer not found!");
+			{
+				std::lock_guard<std::mutex> lock(m_thread_mutex);
+				m_running = false;
+			}
+			m_thread_cv.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
 		}
 
-		void reset_all_timers()
+		bool flush()
 		{
-			for (auto& timer : m_timers)
-				timer.second->reset();
+			COCO_ASSERT(!m_thread.joinable(), "flush() called while the background thread is running");
+			if (m_thread.joinable() || !open_socket())
+				return false;
+			drain();
+			send_aggregates();
+			return true;
 		}
 
-		void stop_all_timers()
+		unsigned long long get_dropped_count() const noexcept
 		{
-			for (auto& timer : m_timers)
-				timer.second->stop();
+			return m_dropped.load(std::memory_order_relaxed);
 		}
 
-		coco::timer<_Duration>* get_timer(const std::string& timer_name)
+		unsigned long long get_sent_packet_count() const noexcept
 		{
-			auto it = m_timers.find(timer_name);
-			if (it != m_timers.end())
-				return m_timers.at(timer_name);
-			COCO_ASSERT(false, "Timer not found");
-			return nullptr;
+			return m_sent_packets.load(std::memory_order_relaxed);
 		}
 
-		void log_statistics(const std::filesystem::path& filepath)
+	private:
+		struct sample
 		{
-			m_data_logger.log_statistics<_Duration>(filepath);
-		}
+			size_t metric_id;
+			long long value;
+		};
 
-		bool is_timer_running(const std::string& timer_name) const
+		struct metric_state
 		{
-			if (m_timers.find(timer_name) != m_timers.end())
-				return !m_timers.at(timer_name)->is_running();
-			COCO_ASSERT(false, "Timer not found!");
-			return false;
-		}
+			std::string name;
+			std::vector<long long> values;
+			long long sum = 0;
+		};
 
-		long long get_elapsed_time(const std::string& timer_name) const
+		bool open_socket()
 		{
-			if (m_timers.find(timer_name) != m_timers.end())
-				return m_timers.at(timer_name)->get_time();
-			COCO_ASSERT(false, "Timer not found!");
-			return 0;
-		}
+			if (m_socket != detail::invalid_socket)
+				return true;
+			if (!detail::network_startup())
+				return false;
 
-		void rename_timer(const std::string& old_name, const std::string& new_name)
-		{
-			if (m_timers.find(new_name) == m_timers.end())
+			addrinfo hints{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_DGRAM;
+			addrinfo* result = nullptr;
+			char service[8];
+			*std::to_chars(service, service + sizeof(service) - 1, m_port).ptr = '\0';
+			if (getaddrinfo(m_host.c_str(), service, &hints, &result) != 0 || !result)
+				return false;
+
+			for (addrinfo* it = result; it; it = it->ai_next)
 			{
-				auto it = m_timers.find(old_name);
-				if (it != m_timers.end())
+				detail::socket_t candidate = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+				if (candidate == detail::invalid_socket)
+					continue;
+				if (connect(candidate, it->ai_addr, static_cast<int>(it->ai_addrlen)) == 0)
 				{
-					m_timers[new_name] = std::move(it->second);
-					m_timers.erase(it);
+					m_socket = candidate;
+					break;
 				}
-				COCO_ASSERT(false, "Timer not found!");
+				detail::close_socket(candidate);
 			}
-			COCO_ASSERT(false, "New timer name already exists!");
+			freeaddrinfo(result);
+			return m_socket != detail::invalid_socket;
 		}
 
-	private:
-		std::unordered_map<std::string, coco::timer<_Duration>*> m_timers;
-		coco::timer_data_logger m_data_logger;
-	};
-
-	class timer_controller
-	{
-	public:
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static void start_timer(_Timer& timer)
-		{
-			timer.start();
-		}
-
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static void stop_timer(_Timer& timer)
+		void drain()
 		{
-			timer.stop();
+			std::lock_guard<std::mutex> lock(m_metrics_mutex);
+			sample current;
+			while (m_queue.try_pop(current))
+			{
+				if (current.metric_id >= m_metrics.size())
+					continue;
+				metric_state& metric = m_metrics[current.metric_id];
+				metric.values.push_back(current.value);
+				metric.sum += current.value;
+			}
 		}
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static void reset_timer(_Timer& timer)
+		void send_aggregates()
 		{
-			timer.reset();
+			std::lock_guard<std::mutex> lock(m_metrics_mutex);
+			m_packet.clear();
+			for (metric_state& metric : m_metrics)
+			{
+				if (metric.values.empty())
+					continue;
+				std::sort(metric.values.begin(), metric.values.end());
+				double count = static_cast<double>(metric.values.size());
+				append_line(metric.name, ".count", count, "|c");
+				append_line(metric.name, ".mean", to_milliseconds(static_cast<double>(metric.sum) / count), "|g");
+				append_line(metric.name, ".min", to_milliseconds(static_cast<double>(metric.values.front())), "|g");
+				append_line(metric.name, ".max", to_milliseconds(static_cast<double>(metric.values.back())), "|g");
+				append_line(metric.name, ".p50", to_milliseconds(static_cast<double>(detail::nearest_rank(metric.values, 0.5))), "|g");
+				append_line(metric.name, ".p90", to_milliseconds(static_cast<double>(detail::nearest_rank(metric.values, 0.9))), "|g");
+				append_line(metric.name, ".p99", to_milliseconds(static_cast<double>(detail::nearest_rank(metric.values, 0.99))), "|g");
+				metric.values.clear();
+				metric.sum = 0;
+			}
+			send_packet();
 		}
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static void pause_timer(_Timer& timer)
+		void append_line(const std::string& name, const char* suffix, double value, const char* type)
 		{
-			timer.pause();
-		}
+			m_line.clear();
+			m_line.append(name).append(suffix).push_back(':');
+			detail::append_double(m_line, value);
+			m_line.append(type);
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static void resume_timer(_Timer& timer)
-		{
-			timer.resume();
+			if (!m_packet.empty() && m_packet.size() + 1 + m_line.size() > m_max_packet_size)
+				send_packet();
+			if (!m_packet.empty())
+				m_packet.push_back('\n');
+			m_packet.append(m_line);
 		}
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static bool is_timer_running(const _Timer& timer)
+		void send_packet()
 		{
-			return timer.is_running();
+			if (m_packet.empty())
+				return;
+			if (send(m_socket, m_packet.data(), static_cast<int>(m_packet.size()), detail::send_flags) > 0)
+				m_sent_packets.fetch_add(1, std::memory_order_relaxed);
+			m_packet.clear();
 		}
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static bool is_timer_paused(const _Timer& timer)
+		static double to_milliseconds(double value)
 		{
-			return timer.is_paused();
+			return detail::to_seconds<_Duration>(value * 1000.0);
 		}
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static long long get_timer_time(const _Timer& timer)
-		{
-			return timer.get_time();
-		}
+		std::string m_host;
+		unsigned short m_port;
+		sch::milliseconds m_flush_interval;
+		size_t m_max_packet_size;
+		detail::socket_t m_socket = detail::invalid_socket;
 
-		template <_COCO_CONCEPT_TIMER_T _Timer _COCO_ENABLE_IF_TIMER_T(_Timer)>
-		static void set_timer_print_state(_Timer& timer, bool state)
-		{
-			timer.set_print_state(state);
-		}
-	};
+		detail::bounded_queue<sample> m_queue;
+		std::atomic<unsigned long long> m_dropped{ 0 };
+		std::atomic<unsigned long long> m_sent_packets{ 0 };
 
-	template <class FunT, class ...Args>
-	void measure(size_t test_count, const std::filesystem::path& filepath, FunT fun, Args&&... args)
-	{
-		timer ctimer(dont_start{});
-		timer_data_logger measurement_stats;
-		for (size_t i = 0; i < test_count; ++i)
-		{
-			ctimer.start();
-			fun(args...);
-			ctimer.stop();
-			measurement_stats.add_measurement(ctimer.get_time());
-		}
-		measurement_stats.log_statistics(filepath);
-	}
+		std::mutex m_metrics_mutex;
+		std::vector<metric_state> m_metrics;
+		std::string m_packet;
+		std::string m_line;
 
+		std::mutex m_thread_mutex;
+		std::condition_variable m_thread_cv;
+		std::atomic<bool> m_running{ false };
+		bool m_restart = false;
+		std::thread m_thread;
+	};
+#endif // COCO_NETWORK
 
 }
 
@@ -823,14 +7160,43 @@ namespace coco
 
 // json
 #define COCO_PROFILE_BEGIN_SESSION(name, filepath)	coco::instrumentor::get().begin_session(name, filepath)
+#define COCO_PROFILE_BEGIN_CTF_SESSION(name, directory)	coco::instrumentor::get().begin_session(name, directory, coco::session_format::ctf)
 #define COCO_PROFILE_END_SESSION()					coco::instrumentor::get().end_session()
 #define COCO_PROFILE_SCOPE(name)					coco::instrumentation_timer _COCO_ADD_COUNTER(timer)(name)
 #define COCO_PROFILE_FUNCTION()						COCO_PROFILE_SCOPE(_COCO_FUNC_SIG)
+#define COCO_PROFILE_CPU_SCOPE(name)				coco::instrumentation_timer _COCO_ADD_COUNTER(timer)(name, coco::cpu_time{})
+#define COCO_PROFILE_CPU_FUNCTION()					COCO_PROFILE_CPU_SCOPE(_COCO_FUNC_SIG)
+#define _COCO_PROFILE_COMPACT_SCOPE_IMPL(name, id)	static const std::uint32_t _COCO_CONCAT(__coco_name_id_, id) = coco::detail::intern_literal(name); static const char* const _COCO_CONCAT(__coco_name_, id) = coco::detail::name_table::get().c_str(_COCO_CONCAT(__coco_name_id_, id)); coco::compact_instrumentation_timer _COCO_CONCAT(__coco_compact_timer_, id)(_COCO_CONCAT(__coco_name_id_, id), _COCO_CONCAT(__coco_name_, id))
+#define COCO_PROFILE_COMPACT_SCOPE(name)			_COCO_PROFILE_COMPACT_SCOPE_IMPL(name, __COUNTER__)
+#define COCO_PROFILE_COMPACT_FUNCTION()				COCO_PROFILE_COMPACT_SCOPE(_COCO_FUNC_SIG)
+#define COCO_PROFILE_DYNAMIC_SCOPE(name)			coco::compact_instrumentation_timer _COCO_ADD_COUNTER(timer)(coco::intern_name(name))
+#define COCO_FRAME_MARK()							coco::frame_profiler::get().mark_frame()
+
+// scope statistics
+#define _COCO_SCOPE_STATS_IMPL(name, id)			static coco::scope_stats_site _COCO_CONCAT(__coco_stats_site_, id)(name); coco::scope_stats_timer _COCO_CONCAT(__coco_stats_timer_, id)(_COCO_CONCAT(__coco_stats_site_, id))
+#define COCO_SCOPE_STATS(name)						_COCO_SCOPE_STATS_IMPL(name, __COUNTER__)
+
+// budget scopes
+#define _COCO_BUDGET_SITE(name, budget, id)			static coco::budget_site _COCO_CONCAT(__coco_budget_site_, id)(name, budget)
+#define _COCO_BUDGET_SCOPE_IMPL(name, budget, id)	_COCO_BUDGET_SITE(name, budget, id); coco::budget_scope<> _COCO_CONCAT(__coco_budget_scope_, id)(_COCO_CONCAT(__coco_budget_site_, id))
+#define _COCO_BUDGET_SCOPE_ARGS_IMPL(name, budget, args, id) _COCO_BUDGET_SITE(name, budget, id); auto _COCO_CONCAT(__coco_budget_scope_, id) = coco::make_budget_scope(_COCO_CONCAT(__coco_budget_site_, id), [&]() { return (args).str(); })
+#define COCO_BUDGET_SCOPE(name, budget)				_COCO_BUDGET_SCOPE_IMPL(name, budget, __COUNTER__)
+#define COCO_BUDGET_SCOPE_ARGS(name, budget, args)	_COCO_BUDGET_SCOPE_ARGS_IMPL(name, budget, args, __COUNTER__)
 #else // COCO_NO_PROFILE
 #define COCO_PROFILE_BEGIN_SESSION(name, filepath)
+#define COCO_PROFILE_BEGIN_CTF_SESSION(name, directory)
 #define COCO_PROFILE_END_SESSION()
 #define COCO_PROFILE_SCOPE(name)
 #define COCO_PROFILE_FUNCTION()
+#define COCO_PROFILE_CPU_SCOPE(name)
+#define COCO_PROFILE_CPU_FUNCTION()
+#define COCO_PROFILE_COMPACT_SCOPE(name)
+#define COCO_PROFILE_COMPACT_FUNCTION()
+#define COCO_PROFILE_DYNAMIC_SCOPE(name)
+#define COCO_FRAME_MARK()
+#define COCO_SCOPE_STATS(name)
+#define COCO_BUDGET_SCOPE(name, budget)
+#define COCO_BUDGET_SCOPE_ARGS(name, budget, args)
 #endif  // COCO_NO_PROFILE
 
 // console
@@ -842,6 +7208,64 @@ namespace coco
 #define COCO_END_TIMER(timer_name)					((_COCO_CONCAT(__coco_time_var_, timer_name)).stop())
 #define COCO_GET_TIMER_VALUE(timer_name)			((_COCO_CONCAT(__coco_time_var_, timer_name)).get_time())
 
+#ifdef COCO_ALLOCATION_TRACER_IMPLEMENTATION
+void* operator new(std::size_t size)
+{
+	void* pointer = coco::detail::traced_allocate(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+	void* pointer = coco::detail::traced_allocate(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return coco::detail::traced_allocate(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return coco::detail::traced_allocate(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	coco::detail::traced_free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	coco::detail::traced_free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	coco::detail::traced_free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	coco::detail::traced_free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	coco::detail::traced_free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	coco::detail::traced_free(pointer);
+}
+#endif // COCO_ALLOCATION_TRACER_IMPLEMENTATION
+
 #undef _COCO_ENABLE_IF_DURATION_T
 #undef _COCO_CONCEPT_DURATION_T
 #undef _COCO_ENABLE_IF_TIMER_T
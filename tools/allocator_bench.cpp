@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Coco library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official Coco GitHub repository:
+ * https://github.com/tynes0/coco
+ *
+ * Measures the statistics overhead of coco::arena_allocator against an uninstrumented bump arena.
+ * Each round performs a fixed mix of allocation sizes followed by a reset.
+ * Usage: allocator_bench [rounds] [allocations per round]
+ */
+
+#include "../coco.h"
+
+#include <iomanip>
+
+class plain_arena
+{
+public:
+	explicit plain_arena(size_t capacity) : m_buffer(static_cast<unsigned char*>(std::malloc(capacity))), m_capacity(capacity) {}
+
+	~plain_arena()
+	{
+		std::free(m_buffer);
+	}
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept
+	{
+		uintptr_t base = reinterpret_cast<uintptr_t>(m_buffer);
+		uintptr_t aligned = (base + m_used + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		size_t offset = static_cast<size_t>(aligned - base);
+		if (!m_buffer || offset + size > m_capacity)
+			return nullptr;
+		m_used = offset + size;
+		return m_buffer + offset;
+	}
+
+	void reset() noexcept
+	{
+		m_used = 0;
+	}
+
+private:
+	unsigned char* m_buffer;
+	size_t m_capacity;
+	size_t m_used = 0;
+};
+
+template <class Arena>
+double run(Arena& arena, size_t rounds, size_t allocations)
+{
+	static constexpr size_t sizes[] = { 8, 24, 40, 64, 16, 128, 32, 256 };
+	volatile uintptr_t sink = 0;
+	auto start = sch::steady_clock::now();
+	for (size_t round = 0; round < rounds; ++round)
+	{
+		for (size_t i = 0; i < allocations; ++i)
+			sink = sink + reinterpret_cast<uintptr_t>(arena.allocate(sizes[i % (sizeof(sizes) / sizeof(sizes[0]))]));
+		arena.reset();
+	}
+	double elapsed = sch::duration<double, std::nano>(sch::steady_clock::now() - start).count();
+	return elapsed / static_cast<double>(rounds * allocations);
+}
+
+int main(int argc, char** argv)
+{
+	size_t rounds = argc > 1 ? static_cast<size_t>(std::atoll(argv[1])) : 20000;
+	size_t allocations = argc > 2 ? static_cast<size_t>(std::atoll(argv[2])) : 200;
+	size_t capacity = allocations * 512;
+
+	plain_arena plain(capacity);
+	coco::arena_allocator sampled("sampled", capacity);
+	coco::arena_allocator every("every", capacity, 1);
+
+	run(plain, rounds / 10 + 1, allocations);
+	double plain_ns = run(plain, rounds, allocations);
+	double sampled_ns = run(sampled, rounds, allocations);
+	double every_ns = run(every, rounds, allocations);
+
+	std::cout << rounds * allocations << " allocations, " << allocations << " per reset\n";
+	std::cout << std::left << std::setw(32) << "plain bump arena" << std::fixed << std::setprecision(2) << plain_ns << " ns/alloc\n";
+	std::cout << std::left << std::setw(32) << "arena_allocator, 1/64 sampled" << sampled_ns << " ns/alloc\n";
+	std::cout << std::left << std::setw(32) << "arena_allocator, every alloc" << every_ns << " ns/alloc\n";
+	sampled.write_report(std::cout);
+	every.write_report(std::cout);
+	return 0;
+}
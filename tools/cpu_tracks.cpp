@@ -0,0 +1,64 @@
+/*
+ * This file is part of the Coco library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official Coco GitHub repository:
+ * https://github.com/tynes0/coco
+ *
+ * Rewrites a Chrome trace recorded with instrumentor::set_cpu_tracking(true) into a per-CPU track layout, where every
+ * scope is moved to a "CPU n" process for the core it started on and keeps its thread, and prints how often each scope
+ * migrated between cores.
+ * Usage: cpu_tracks -o per_cpu.json <trace file>
+ */
+
+#include "../coco.h"
+
+#include <iomanip>
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path output;
+	std::filesystem::path input;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else
+			input = argument;
+	}
+
+	if (input.empty() || output.empty())
+	{
+		std::cerr << "usage: " << argv[0] << " -o per_cpu.json <trace file>\n";
+		return 1;
+	}
+
+	std::vector<std::string> events;
+	if (!coco::read_trace_events(input, events))
+	{
+		std::cerr << "failed to read trace file: " << input << "\n";
+		return 1;
+	}
+
+	std::vector<coco::scope_migration_stats> migrations = coco::count_cpu_migrations(events);
+	if (migrations.empty())
+	{
+		std::cerr << "no CPU ids found in " << input << ", record it with instrumentor::set_cpu_tracking(true)\n";
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(48) << "scope" << std::right << std::setw(10) << "scopes" << std::setw(10) << "migrated" << std::setw(10) << "rate\n";
+	for (const coco::scope_migration_stats& stats : migrations)
+	{
+		std::cout << std::left << std::setw(48) << stats.name.substr(0, 47) << std::right << std::setw(10) << stats.scopes << std::setw(10) << stats.migrated
+			<< std::setw(8) << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(stats.migrated) / static_cast<double>(stats.scopes) << "%\n";
+	}
+
+	std::vector<std::string> layout = coco::cpu_track_layout(events);
+	if (!coco::write_trace_events(output, layout))
+	{
+		std::cerr << "failed to write per-CPU trace: " << output << "\n";
+		return 1;
+	}
+	std::cout << "Wrote " << layout.size() << " events to " << output.string() << "\n";
+	return 0;
+}
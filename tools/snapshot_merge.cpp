@@ -0,0 +1,78 @@
+/*
+ * This file is part of the Coco library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official Coco GitHub repository:
+ * https://github.com/tynes0/coco
+ *
+ * Merges statistics snapshot files written by coco::write_snapshots from several processes into one report.
+ * Usage: snapshot_merge [-o merged.snap] <snapshot files...>
+ */
+
+#include "../coco.h"
+
+#include <iomanip>
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path output;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else
+			inputs.emplace_back(argument);
+	}
+
+	if (inputs.empty())
+	{
+		std::cerr << "usage: " << argv[0] << " [-o merged.snap] <snapshot files...>\n";
+		return 1;
+	}
+
+	std::vector<coco::statistics_snapshot> merged;
+	std::unordered_map<std::string, size_t> index;
+	for (const auto& input : inputs)
+	{
+		std::vector<coco::statistics_snapshot> snapshots;
+		if (!coco::read_snapshots(input, snapshots))
+		{
+			std::cerr << "failed to read snapshot file: " << input << "\n";
+			return 1;
+		}
+
+		for (auto& snapshot : snapshots)
+		{
+			std::string key = snapshot.name + '\0' + snapshot.unit;
+			auto it = index.find(key);
+			if (it == index.end())
+			{
+				index.emplace(key, merged.size());
+				merged.push_back(std::move(snapshot));
+			}
+			else if (!merged[it->second].merge(snapshot))
+			{
+				std::cerr << "incompatible snapshots for series: " << snapshot.name << "\n";
+				return 1;
+			}
+		}
+	}
+
+	std::cout << "Merged " << inputs.size() << " snapshot files\n";
+	std::cout << std::left << std::setw(32) << "series" << std::right << std::setw(12) << "count" << std::setw(14) << "mean" << std::setw(14) << "stddev"
+		<< std::setw(14) << "min" << std::setw(14) << "p50" << std::setw(14) << "p90" << std::setw(14) << "p99" << std::setw(14) << "max" << "  unit\n";
+	for (const auto& snapshot : merged)
+	{
+		std::cout << std::left << std::setw(32) << snapshot.name << std::right << std::setw(12) << snapshot.moments.get_count()
+			<< std::setw(14) << snapshot.moments.get_mean() << std::setw(14) << snapshot.moments.get_standard_deviation()
+			<< std::setw(14) << snapshot.moments.get_min() << std::setw(14) << snapshot.quantile(0.5) << std::setw(14) << snapshot.quantile(0.9)
+			<< std::setw(14) << snapshot.quantile(0.99) << std::setw(14) << snapshot.moments.get_max() << "  " << snapshot.unit << "\n";
+	}
+
+	if (!output.empty() && !coco::write_snapshots(output, merged))
+	{
+		std::cerr << "failed to write merged snapshot: " << output << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of the Coco library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official Coco GitHub repository:
+ * https://github.com/tynes0/coco
+ *
+ * Merges Chrome trace files written by the coco instrumentor from several processes into one trace.
+ * Traces from the same host are aligned on CLOCK_MONOTONIC through each session's clock anchor; traces from other hosts
+ * fall back to the wall clock and can be corrected with a manual offset (in milliseconds) given before the file.
+ * Usage: trace_merge -o merged.json [-t offset_ms] <trace file> [[-t offset_ms] <trace file>...]
+ */
+
+#include "../coco.h"
+
+#include <iomanip>
+
+struct trace_input
+{
+	std::filesystem::path path;
+	double manual_offset_ms = 0.0;
+	std::vector<std::string> events;
+	coco::trace_clock_anchor anchor;
+	bool anchored = false;
+};
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path output;
+	std::vector<trace_input> inputs;
+	double pending_offset = 0.0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else if (argument == "-t" && i + 1 < argc)
+			pending_offset = std::atof(argv[++i]);
+		else
+		{
+			inputs.push_back(trace_input{ argument, pending_offset, {}, {}, false });
+			pending_offset = 0.0;
+		}
+	}
+
+	if (inputs.empty() || output.empty())
+	{
+		std::cerr << "usage: " << argv[0] << " -o merged.json [-t offset_ms] <trace file> [[-t offset_ms] <trace file>...]\n";
+		return 1;
+	}
+
+	const coco::trace_clock_anchor* reference = nullptr;
+	for (auto& input : inputs)
+	{
+		if (!coco::read_trace_events(input.path, input.events))
+		{
+			std::cerr << "failed to read trace file: " << input.path << "\n";
+			return 1;
+		}
+		input.anchored = coco::find_trace_anchor(input.events, input.anchor);
+		if (input.anchored && !reference)
+			reference = &input.anchor;
+	}
+
+	std::vector<std::string> metadata;
+	std::vector<std::string> events;
+	std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(10) << "pid" << std::setw(10) << "events" << std::setw(16) << "shift (ns)" << "  alignment\n";
+	for (size_t index = 0; index < inputs.size(); ++index)
+	{
+		trace_input& input = inputs[index];
+		long long shift_ns = static_cast<long long>(input.manual_offset_ms * 1e6);
+		const char* alignment = "none";
+		if (input.anchored)
+		{
+			shift_ns += coco::trace_alignment_ns(*reference, input.anchor);
+			alignment = input.anchor.host == reference->host ? "monotonic" : "realtime";
+		}
+		long long ts_per_second = input.anchored ? input.anchor.ts_per_second : 1000;
+		long long shift = static_cast<long long>(std::llround(static_cast<double>(shift_ns) * static_cast<double>(ts_per_second) / 1e9));
+
+		std::cout << std::left << std::setw(40) << input.path.string() << std::right << std::setw(10) << input.anchor.pid
+			<< std::setw(10) << input.events.size() << std::setw(16) << shift_ns << "  " << alignment << "\n";
+
+		if (input.anchored)
+		{
+			metadata.push_back("{\"args\":{\"sort_index\":" + std::to_string(index) + "},\"cat\":\"__metadata\",\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":"
+				+ std::to_string(input.anchor.pid) + ",\"tid\":0,\"ts\":0}");
+		}
+		for (auto& event : input.events)
+		{
+			if (coco::detail::is_metadata_event(event))
+				metadata.push_back(std::move(event));
+			else if (coco::shift_trace_event(event, shift))
+				events.push_back(std::move(event));
+		}
+	}
+
+	metadata.insert(metadata.end(), std::make_move_iterator(events.begin()), std::make_move_iterator(events.end()));
+	if (!coco::write_trace_events(output, metadata))
+	{
+		std::cerr << "failed to write merged trace: " << output << "\n";
+		return 1;
+	}
+	std::cout << "Merged " << inputs.size() << " trace files into " << output.string() << " (" << metadata.size() << " events)\n";
+	return 0;
+}